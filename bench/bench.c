@@ -0,0 +1,605 @@
+/*
+ * Benchmarks for every string function in stringutils.h, see README for how to build and run it.
+ * Results are printed as JSON on stdout, progress goes to stderr.
+ */
+#include "../stringutils.h"
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/resource.h>
+
+typedef struct bench_input {
+    const char* kind;       // how the haystack was generated
+    char* str;              // haystack, NUL terminated
+    strview view;
+    size_t len;
+    char c;                 // planted single character
+    char* needle;           // planted string
+    strview nview;
+    char* params;           // set of characters containing c
+    charset cs;
+    compiled_needle* cn;
+    multi_pattern* mp;
+    char** reps;
+    char* buf;              // scratch buffer for the _into functions
+    size_t cap;
+    FILE* file;             // haystack in a file, for the tokenizer
+    char path[64];          // haystack in a file, for map_file()
+    mapped_file* mf;
+    rope* rope;             // haystack appended 1KB at a time
+    glob_pattern* glob;
+    token_histogram* hist;  // whitespace separated tokens of the haystack
+    char** lines;           // haystack cut in 32 byte strings, for match_many() and the batch functions
+    int* results;
+    int nlines;
+    char* numbers;          // haystack sized list of decimal numbers separated by ','
+    strview* dfields;       // every number of numbers
+    strview* ifields;       // integer part of every number
+    double* values;
+    long long* ints;
+    int nnumbers;
+} bench_input;
+
+typedef struct bench_case {
+    const char* name;
+    long long (*run)(bench_input* in);
+} bench_case;
+
+static char* PATTERNS[] = { "needle", ",", "aaab" };
+// The parallel_ cases run with a pool of a thread per cpu (at least 2) and chunks this small, so every size from 8KB is split
+#define PARALLEL_BENCH_CHUNK 4096
+static char* REPS[] = { "NEEDLE!", ";", "b" };
+
+#define CASE(name, expr) static long long bench_##name(bench_input* in) { return (long long)(expr); }
+#define CASE_PTR(name, expr) static long long bench_##name(bench_input* in) { return (long long)(intptr_t)(expr); }
+#define CASE_VIEW(name, expr) static long long bench_##name(bench_input* in) { return (long long)(expr).len; }
+
+CASE_PTR(trim, trim(in->str))
+CASE_PTR(trimchar, trimchar(in->str, in->c))
+CASE_PTR(trimnchar, trimnchar(in->str, in->params))
+CASE_PTR(trimstr, trimstr(in->str, in->needle))
+CASE_PTR(trimend, trimend(in->str))
+CASE_PTR(trimendchar, trimendchar(in->str, in->c))
+CASE_PTR(trimendnchar, trimendnchar(in->str, in->params))
+CASE_PTR(trimendstr, trimendstr(in->str, in->needle))
+CASE_PTR(trimstart, trimstart(in->str))
+CASE_PTR(trimstartchar, trimstartchar(in->str, in->c))
+CASE_PTR(trimstartnchar, trimstartnchar(in->str, in->params))
+CASE_PTR(trimstartstr, trimstartstr(in->str, in->needle))
+CASE_PTR(trimcs, trimcs(in->str, &in->cs))
+CASE_PTR(trimendcs, trimendcs(in->str, &in->cs))
+CASE_PTR(trimstartcs, trimstartcs(in->str, &in->cs))
+CASE(trim_into, trim_into(in->buf, in->cap, in->str))
+CASE(trimchar_into, trimchar_into(in->buf, in->cap, in->str, in->c))
+CASE(trimnchar_into, trimnchar_into(in->buf, in->cap, in->str, in->params))
+CASE(trimstr_into, trimstr_into(in->buf, in->cap, in->str, in->needle))
+CASE(trimend_into, trimend_into(in->buf, in->cap, in->str))
+CASE(trimendchar_into, trimendchar_into(in->buf, in->cap, in->str, in->c))
+CASE(trimendnchar_into, trimendnchar_into(in->buf, in->cap, in->str, in->params))
+CASE(trimendstr_into, trimendstr_into(in->buf, in->cap, in->str, in->needle))
+CASE(trimstart_into, trimstart_into(in->buf, in->cap, in->str))
+CASE(trimstartchar_into, trimstartchar_into(in->buf, in->cap, in->str, in->c))
+CASE(trimstartnchar_into, trimstartnchar_into(in->buf, in->cap, in->str, in->params))
+CASE(trimstartstr_into, trimstartstr_into(in->buf, in->cap, in->str, in->needle))
+CASE(trimcs_into, trimcs_into(in->buf, in->cap, in->str, &in->cs))
+CASE(trimendcs_into, trimendcs_into(in->buf, in->cap, in->str, &in->cs))
+CASE(trimstartcs_into, trimstartcs_into(in->buf, in->cap, in->str, &in->cs))
+CASE_PTR(strncopy, strncopy(in->str, in->len / 2))
+CASE_PTR(strcopy, strcopy(in->str))
+CASE(count, count(in->str, in->needle))
+CASE(countc, countc(in->str, in->c))
+CASE(countnc, countnc(in->str, in->params))
+CASE(countcs, countcs(in->str, &in->cs))
+static long long bench_split(bench_input* in) { int n; split(in->str, &n); return n; }
+static long long bench_splitc(bench_input* in) { int n; splitc(in->str, in->c, &n); return n; }
+static long long bench_splitnc(bench_input* in) { int n; splitnc(in->str, in->params, &n); return n; }
+static long long bench_splitcs(bench_input* in) { int n; splitcs(in->str, &in->cs, &n); return n; }
+static long long bench_splitstr(bench_input* in) { int n; splitstr(in->str, in->needle, &n); return n; }
+// The whole copy gets released right away, so the registry doesn't grow between batches
+static long long bench_free_string(bench_input* in) { char* s = strcopy(in->str); free_string(s); return 0; }
+static long long bench_free_vect(bench_input* in) { int n; char** v = splitc(in->str, in->c, &n); free_vect(v); return n; }
+CASE(endswith, endswith(in->str, in->needle))
+CASE(endswithc, endswithc(in->str, in->c))
+CASE(startswith, startswith(in->str, in->needle))
+CASE(startswithc, startswithc(in->str, in->c))
+CASE(contains, contains(in->str, in->needle))
+CASE(containsc, containsc(in->str, in->c))
+CASE(find, find(in->str, in->needle))
+CASE(findc, findc(in->str, in->c))
+CASE(rfind, rfind(in->str, in->needle))
+CASE(rfindc, rfindc(in->str, in->c))
+CASE(findcs, findcs(in->str, &in->cs))
+CASE(rfindcs, rfindcs(in->str, &in->cs))
+CASE_PTR(sum, sum(in->str, in->needle))
+CASE_PTR(sub, sub(in->str, in->c))
+CASE(sub_into, sub_into(in->buf, in->cap, in->str, in->c))
+CASE_PTR(removenc, removenc(in->str, in->params))
+CASE_PTR(removecs, removecs(in->str, &in->cs))
+CASE(removecs_into, removecs_into(in->buf, in->cap, in->str, &in->cs))
+CASE_PTR(append, append(in->str, in->c))
+CASE_PTR(toupperstr, toupperstr(in->str))
+CASE(toupperstr_into, toupperstr_into(in->buf, in->cap, in->str))
+CASE_PTR(tolowerstr, tolowerstr(in->str))
+CASE(tolowerstr_into, tolowerstr_into(in->buf, in->cap, in->str))
+CASE_PTR(toupperstr_locale, toupperstr_locale(in->str))
+CASE_PTR(tolowerstr_locale, tolowerstr_locale(in->str))
+CASE(ifind, ifind(in->str, in->needle))
+CASE(icount, icount(in->str, in->needle))
+CASE(istartswith, istartswith(in->str, in->needle))
+CASE(iendswith, iendswith(in->str, in->needle))
+CASE_PTR(ireplace, ireplace(in->str, in->needle, "NEEDLE!"))
+CASE_PTR(zip_string, zip_string(in->str))
+CASE(zip_string_into, zip_string_into(in->buf, in->cap, in->str))
+CASE_PTR(replace, replace(in->str, in->needle, "NEEDLE!"))
+CASE(replace_into, replace_into(in->buf, in->cap, in->str, in->needle, "NEEDLE!"))
+CASE_PTR(replacec, replacec(in->str, in->c, ';'))
+CASE(replacec_into, replacec_into(in->buf, in->cap, in->str, in->c, ';'))
+CASE_PTR(substr, substr(in->str, 1, -1))
+CASE(substr_into, substr_into(in->buf, in->cap, in->str, 1, -1))
+CASE(charset_from, charset_from(in->params).bits[0])
+CASE_VIEW(sv_trimcs, sv_trimcs(in->view, &in->cs))
+CASE_VIEW(sv_trimendcs, sv_trimendcs(in->view, &in->cs))
+CASE_VIEW(sv_trimstartcs, sv_trimstartcs(in->view, &in->cs))
+CASE(sv_findcs, sv_findcs(in->view, &in->cs))
+CASE(sv_rfindcs, sv_rfindcs(in->view, &in->cs))
+CASE(sv_countcs, sv_countcs(in->view, &in->cs))
+CASE_VIEW(sv_from, sv_from(in->str))
+CASE_PTR(sv_tostr, sv_tostr(in->view))
+CASE(sv_into, sv_into(in->buf, in->cap, in->view))
+CASE(sv_equals, sv_equals(in->view, sv_fromn(in->buf, in->len)))
+CASE_VIEW(sv_trim, sv_trim(in->view))
+CASE_VIEW(sv_trimchar, sv_trimchar(in->view, in->c))
+CASE_VIEW(sv_trimnchar, sv_trimnchar(in->view, in->params))
+CASE_VIEW(sv_trimstr, sv_trimstr(in->view, in->nview))
+CASE_VIEW(sv_trimend, sv_trimend(in->view))
+CASE_VIEW(sv_trimendchar, sv_trimendchar(in->view, in->c))
+CASE_VIEW(sv_trimendnchar, sv_trimendnchar(in->view, in->params))
+CASE_VIEW(sv_trimendstr, sv_trimendstr(in->view, in->nview))
+CASE_VIEW(sv_trimstart, sv_trimstart(in->view))
+CASE_VIEW(sv_trimstartchar, sv_trimstartchar(in->view, in->c))
+CASE_VIEW(sv_trimstartnchar, sv_trimstartnchar(in->view, in->params))
+CASE_VIEW(sv_trimstartstr, sv_trimstartstr(in->view, in->nview))
+CASE_VIEW(sv_substr, sv_substr(in->view, 1, in->len - 1))
+CASE(sv_startswith, sv_startswith(in->view, in->nview))
+CASE(sv_endswith, sv_endswith(in->view, in->nview))
+CASE(sv_find, sv_find(in->view, in->nview))
+CASE(sv_rfind, sv_rfind(in->view, in->nview))
+CASE(sv_findc, sv_findc(in->view, in->c))
+CASE(sv_rfindc, sv_rfindc(in->view, in->c))
+CASE(sv_findnc, sv_findnc(in->view, in->params))
+CASE(sv_rfindnc, sv_rfindnc(in->view, in->params))
+CASE(sv_count, sv_count(in->view, in->nview))
+CASE(sv_countc, sv_countc(in->view, in->c))
+
+#define CASE_SPLIT(name, call) static long long bench_##name(bench_input* in) { \
+    strview rest = in->view, token; long long n = 0; \
+    while (call) n++; \
+    return n; }
+CASE_SPLIT(sv_split_next, sv_split_next(&rest, &token))
+CASE_SPLIT(sv_splitc_next, sv_splitc_next(&rest, in->c, &token))
+CASE_SPLIT(sv_splitnc_next, sv_splitnc_next(&rest, in->params, &token))
+CASE_SPLIT(sv_splitcs_next, sv_splitcs_next(&rest, &in->cs, &token))
+CASE_SPLIT(sv_splitstr_next, sv_splitstr_next(&rest, in->nview, &token))
+
+static long long bench_compile_needle(bench_input* in) { compiled_needle* cn = compile_needle(in->needle); free_needle(cn); return 0; }
+CASE(find_compiled, find_compiled(in->view, in->cn))
+CASE(rfind_compiled, rfind_compiled(in->view, in->cn))
+CASE(count_compiled, count_compiled(in->view, in->cn))
+static long long bench_compile_patterns(bench_input* in) { (void)in; multi_pattern* mp = compile_patterns(PATTERNS, 3); free_patterns(mp); return 0; }
+static long long bench_find_any(bench_input* in) { int which; return find_any(in->view, in->mp, &which); }
+static long long bench_count_each(bench_input* in) { long long counts[3]; count_each(in->view, in->mp, counts); return counts[0]; }
+CASE_PTR(replace_many, replace_many(in->str, in->mp, in->reps))
+
+#define CASE_TOKENIZER(name, sep) static long long bench_##name(bench_input* in) { \
+    rewind(in->file); \
+    stream_tokenizer* tok = tokenizer_open_file(in->file, sep, 0); \
+    strview token; long long n = 0; \
+    while (tokenizer_next(tok, &token)) n++; \
+    tokenizer_close(tok); \
+    return n; }
+CASE_TOKENIZER(tokenizer_whitespace, sep_whitespace())
+CASE_TOKENIZER(tokenizer_char, sep_char(in->c))
+CASE_TOKENIZER(tokenizer_charset, sep_charset(in->params))
+CASE_TOKENIZER(tokenizer_string, sep_string(in->needle))
+
+// The intern table gets emptied at the end of every call, so each call pays for inserting what it interns
+static long long bench_intern(bench_input* in) {
+    long long n = 0;
+    for (int i = 0; i < in->nlines; i++)
+        n += intern(in->lines[i]) != NULL;
+    clear_interned_stringutils();
+    return n;
+}
+static long long bench_sv_intern(bench_input* in) {
+    strview rest = in->view, token;
+    long long n = 0;
+    while (sv_splitc_next(&rest, ' ', &token))
+        n += sv_intern(token) != NULL;
+    clear_interned_stringutils();
+    return n;
+}
+static long long bench_split_interned(bench_input* in) {
+    int n;
+    intern_on_split_stringutils(1);
+    split(in->str, &n);
+    intern_on_split_stringutils(0);
+    clear_interned_stringutils();
+    return n;
+}
+#define CASE_HISTOGRAM(name, max, expr) static long long bench_##name(bench_input* in) { \
+    token_histogram* h = histogram_create(max); \
+    expr; \
+    long long n = (long long)h->count; \
+    histogram_free(h); \
+    return n; }
+CASE_HISTOGRAM(histogram_count, 0, histogram_count(h, in->view, sep_whitespace()))
+CASE_HISTOGRAM(histogram_count_bounded, 256, histogram_count(h, in->view, sep_whitespace()))
+CASE_HISTOGRAM(histogram_count_file, 0, (rewind(in->file), histogram_count_file(h, in->file, sep_whitespace())))
+CASE(histogram_get, histogram_get(in->hist, in->nview))
+static long long bench_histogram_top(bench_input* in) { token_count top[10]; return (long long)histogram_top(in->hist, top, 10); }
+
+#define CASE_BATCH(name, expr) static long long bench_##name(bench_input* in) { \
+    strbatch batch = expr; \
+    long long n = (long long)batch.offsets[batch.count]; \
+    free_batch(&batch); \
+    return n; }
+CASE_BATCH(trim_batch, trim_batch(in->lines, in->nlines))
+CASE_BATCH(trimchar_batch, trimchar_batch(in->lines, in->nlines, 'a'))
+CASE_BATCH(trimnchar_batch, trimnchar_batch(in->lines, in->nlines, "abc"))
+CASE_BATCH(toupperstr_batch, toupperstr_batch(in->lines, in->nlines))
+CASE_BATCH(tolowerstr_batch, tolowerstr_batch(in->lines, in->nlines))
+CASE_BATCH(replacec_batch, replacec_batch(in->lines, in->nlines, 'a', 'A'))
+CASE_BATCH(replace_batch, replace_batch(in->lines, in->nlines, "ab", "AB!"))
+CASE_BATCH(zip_string_batch, zip_string_batch(in->lines, in->nlines))
+CASE_BATCH(sub_batch, sub_batch(in->lines, in->nlines, 'a'))
+
+static long long bench_sb_appendc(bench_input* in) {
+    strbuilder sb;
+    sb_init(&sb, 0);
+    for (size_t i = 0; i < in->len; i++)
+        sb_appendc(&sb, in->str[i]);
+    return (long long)(intptr_t)sb_finish(&sb);
+}
+static long long bench_sb_appendn(bench_input* in) {
+    strbuilder sb;
+    sb_init(&sb, 0);
+    for (size_t i = 0; i < in->len; i += 16)
+        sb_appendn(&sb, in->str + i, in->len - i < 16 ? in->len - i : 16);
+    return (long long)(intptr_t)sb_finish(&sb);
+}
+static long long bench_sb_appendf(bench_input* in) {
+    strbuilder sb;
+    sb_init(&sb, 0);
+    for (size_t i = 0; i < in->len; i += 16)
+        sb_appendf(&sb, "%.*s", (int)(in->len - i < 16 ? in->len - i : 16), in->str + i);
+    return (long long)(intptr_t)sb_finish(&sb);
+}
+static long long bench_map_file(bench_input* in) { mapped_file* mf = map_file(in->path); long long n = mf->count; unmap_file(mf); return n; }
+static long long bench_mf_line(bench_input* in) {
+    long long n = 0;
+    for (size_t i = 0; i < in->mf->count; i++)
+        n += mf_line(in->mf, i).len;
+    return n;
+}
+static long long bench_sv_splitc_into(bench_input* in) { strview fields[64]; return sv_splitc_into(in->view, in->c, fields, 64); }
+static long long bench_rope_insert_erase(bench_input* in) {
+    rope_insert(in->rope, in->len / 2, sv_from("x"));
+    rope_erase(in->rope, in->len / 2, 1);
+    return rope_length(in->rope);
+}
+static long long bench_rope_substr(bench_input* in) { rope* sub = rope_substr(in->rope, in->len / 4, in->len / 2); rope_free(sub); return 0; }
+CASE(rope_find, rope_find(in->rope, in->nview, 0))
+CASE(rope_count, rope_count(in->rope, in->nview))
+CASE_PTR(rope_flatten, rope_flatten(in->rope))
+static long long bench_compile_glob(bench_input* in) { (void)in; glob_pattern* g = compile_glob("/api/v?/[a-z]*/**.json", GlobPathname); free_glob(g); return 0; }
+CASE(match_glob, match_glob(in->view, in->glob))
+CASE(match_many, match_many(in->lines, in->nlines, in->glob, in->results))
+CASE(sv_parse_column_ll, sv_parse_column_ll(in->ifields, in->nnumbers, in->ints, NULL))
+CASE(sv_parse_column_double, sv_parse_column_double(in->dfields, in->nnumbers, in->values, NULL))
+CASE(parallel_countc, countc(in->str, in->c))
+CASE(parallel_count, count(in->str, in->needle))
+CASE_PTR(parallel_replacec, replacec(in->str, in->c, ';'))
+CASE_PTR(parallel_replace, replace(in->str, in->needle, "NEEDLE!"))
+CASE_PTR(parallel_toupperstr, toupperstr(in->str))
+CASE_PTR(parallel_tolowerstr, tolowerstr(in->str))
+static long long bench_format_double_into(bench_input* in) {
+    long long n = 0;
+    for (int i = 0; i < in->nnumbers; i++)
+        n += format_double_into(in->buf, in->cap, in->values[i]);
+    return n;
+}
+static long long bench_csv_next(bench_input* in) {
+    csv_reader* csv = csv_open(in->view, ',');
+    strview* fields; long long n = 0;
+    while (csv_next(csv, &fields)) n++;
+    csv_close(csv);
+    return n;
+}
+static long long bench_csv_next_file(bench_input* in) {
+    rewind(in->file);
+    csv_reader* csv = csv_open_file(in->file, ',', 0);
+    strview* fields; long long n = 0;
+    while (csv_next(csv, &fields)) n++;
+    csv_close(csv);
+    return n;
+}
+
+#define ENTRY(name) { #name, bench_##name }
+static const bench_case CASES[] = {
+    ENTRY(trim), ENTRY(trimchar), ENTRY(trimnchar), ENTRY(trimstr), ENTRY(trimend), ENTRY(trimendchar), ENTRY(trimendnchar),
+    ENTRY(trimendstr), ENTRY(trimstart), ENTRY(trimstartchar), ENTRY(trimstartnchar), ENTRY(trimstartstr),
+    ENTRY(trimcs), ENTRY(trimendcs), ENTRY(trimstartcs),
+    ENTRY(trim_into), ENTRY(trimchar_into), ENTRY(trimnchar_into), ENTRY(trimstr_into), ENTRY(trimend_into),
+    ENTRY(trimendchar_into), ENTRY(trimendnchar_into), ENTRY(trimendstr_into), ENTRY(trimstart_into), ENTRY(trimstartchar_into),
+    ENTRY(trimstartnchar_into), ENTRY(trimstartstr_into), ENTRY(trimcs_into), ENTRY(trimendcs_into), ENTRY(trimstartcs_into),
+    ENTRY(strncopy), ENTRY(strcopy), ENTRY(count), ENTRY(countc), ENTRY(countnc), ENTRY(countcs),
+    ENTRY(split), ENTRY(splitc), ENTRY(splitnc), ENTRY(splitcs), ENTRY(splitstr), ENTRY(free_string), ENTRY(free_vect),
+    ENTRY(endswith), ENTRY(endswithc), ENTRY(startswith), ENTRY(startswithc), ENTRY(contains), ENTRY(containsc),
+    ENTRY(find), ENTRY(findc), ENTRY(rfind), ENTRY(rfindc), ENTRY(findcs), ENTRY(rfindcs),
+    ENTRY(sum), ENTRY(sub), ENTRY(sub_into), ENTRY(removenc), ENTRY(removecs), ENTRY(removecs_into), ENTRY(append), ENTRY(toupperstr), ENTRY(toupperstr_into),
+    ENTRY(tolowerstr), ENTRY(tolowerstr_into), ENTRY(toupperstr_locale), ENTRY(tolowerstr_locale),
+    ENTRY(ifind), ENTRY(icount), ENTRY(istartswith), ENTRY(iendswith), ENTRY(ireplace),
+    ENTRY(zip_string), ENTRY(zip_string_into),
+    ENTRY(replace), ENTRY(replace_into), ENTRY(replacec), ENTRY(replacec_into), ENTRY(substr), ENTRY(substr_into),
+    ENTRY(charset_from), ENTRY(sv_trimcs), ENTRY(sv_trimendcs), ENTRY(sv_trimstartcs),
+    ENTRY(sv_findcs), ENTRY(sv_rfindcs), ENTRY(sv_countcs),
+    ENTRY(sv_from), ENTRY(sv_tostr), ENTRY(sv_into), ENTRY(sv_equals),
+    ENTRY(sv_trim), ENTRY(sv_trimchar), ENTRY(sv_trimnchar), ENTRY(sv_trimstr), ENTRY(sv_trimend), ENTRY(sv_trimendchar),
+    ENTRY(sv_trimendnchar), ENTRY(sv_trimendstr), ENTRY(sv_trimstart), ENTRY(sv_trimstartchar), ENTRY(sv_trimstartnchar),
+    ENTRY(sv_trimstartstr), ENTRY(sv_substr), ENTRY(sv_startswith), ENTRY(sv_endswith),
+    ENTRY(sv_find), ENTRY(sv_rfind), ENTRY(sv_findc), ENTRY(sv_rfindc), ENTRY(sv_findnc), ENTRY(sv_rfindnc),
+    ENTRY(sv_count), ENTRY(sv_countc),
+    ENTRY(sv_split_next), ENTRY(sv_splitc_next), ENTRY(sv_splitnc_next), ENTRY(sv_splitcs_next), ENTRY(sv_splitstr_next),
+    ENTRY(compile_needle), ENTRY(find_compiled), ENTRY(rfind_compiled), ENTRY(count_compiled),
+    ENTRY(compile_patterns), ENTRY(find_any), ENTRY(count_each), ENTRY(replace_many),
+    ENTRY(tokenizer_whitespace), ENTRY(tokenizer_char), ENTRY(tokenizer_charset), ENTRY(tokenizer_string),
+    ENTRY(intern), ENTRY(sv_intern), ENTRY(split_interned),
+    ENTRY(histogram_count), ENTRY(histogram_count_bounded), ENTRY(histogram_count_file), ENTRY(histogram_get), ENTRY(histogram_top),
+    ENTRY(trim_batch), ENTRY(trimchar_batch), ENTRY(trimnchar_batch), ENTRY(toupperstr_batch), ENTRY(tolowerstr_batch),
+    ENTRY(replacec_batch), ENTRY(replace_batch), ENTRY(zip_string_batch), ENTRY(sub_batch),
+    ENTRY(sb_appendc), ENTRY(sb_appendn), ENTRY(sb_appendf),
+    ENTRY(map_file), ENTRY(mf_line), ENTRY(sv_splitc_into),
+    ENTRY(rope_insert_erase), ENTRY(rope_substr), ENTRY(rope_find), ENTRY(rope_count), ENTRY(rope_flatten),
+    ENTRY(compile_glob), ENTRY(match_glob), ENTRY(match_many),
+    ENTRY(parallel_countc), ENTRY(parallel_count), ENTRY(parallel_replacec), ENTRY(parallel_replace),
+    ENTRY(parallel_toupperstr), ENTRY(parallel_tolowerstr),
+    ENTRY(sv_parse_column_ll), ENTRY(sv_parse_column_double), ENTRY(format_double_into),
+    ENTRY(csv_next), ENTRY(csv_next_file),
+};
+
+// Haystacks: letters and spaces that never form the planted needle, with "needle," planted every `every` bytes (0 for never),
+// or one of the adversarial patterns for the search functions
+static const struct { const char* kind; size_t every; } KINDS[] = {
+    { "none", 0 }, { "1/1024", 1024 }, { "1/64", 64 }, { "1/8", 8 }, { "adversarial-a", 0 }, { "adversarial-ab", 0 },
+};
+
+static uint64_t rng = 88172645463325252ULL;
+static uint64_t next_rand(void) {
+    rng ^= rng << 13;
+    rng ^= rng >> 7;
+    rng ^= rng << 17;
+    return rng;
+}
+
+static double now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static long peak_rss_kb(void) {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    return usage.ru_maxrss;
+}
+
+static void reset_peak_rss(void) {
+#ifdef __linux__
+    // Writing 5 to clear_refs resets the high water mark reported by getrusage()
+    FILE* f = fopen("/proc/self/clear_refs", "w");
+    if (f != NULL) {
+        fputs("5", f);
+        fclose(f);
+    }
+#endif
+}
+
+static unsigned long long registry_allocs(void) {
+    return expose_internal_strings()->contains + expose_internal_vectors()->contains;
+}
+
+// Returns 0 (with everything freed) when the buffers for this size don't fit in memory
+static int make_input(bench_input* in, size_t kind, size_t len) {
+    static const char letters[] = "abcfghijkmopqrstuvwxyz";
+    memset(in, 0, sizeof(*in));
+    in->kind = KINDS[kind].kind;
+    in->len = len;
+    in->str = malloc(len + 1);
+    in->cap = len * 2 + 16;
+    in->buf = malloc(in->cap);
+    in->nlines = (int)(len / 32);
+    in->lines = malloc((sizeof(char*) + 32) * (size_t)in->nlines + 1);
+    in->results = malloc(sizeof(int) * (in->nlines + 1));
+    in->numbers = malloc(len + 32);
+    // Every number takes at least 4 bytes ("0.0,")
+    in->dfields = malloc(sizeof(strview) * (len / 4 + 1));
+    in->ifields = malloc(sizeof(strview) * (len / 4 + 1));
+    in->values = malloc(sizeof(double) * (len / 4 + 1));
+    in->ints = malloc(sizeof(long long) * (len / 4 + 1));
+    if (in->str == NULL || in->buf == NULL || in->lines == NULL || in->results == NULL || in->numbers == NULL
+        || in->dfields == NULL || in->ifields == NULL || in->values == NULL || in->ints == NULL) {
+        free(in->ints);
+        free(in->values);
+        free(in->ifields);
+        free(in->dfields);
+        free(in->numbers);
+        free(in->results);
+        free(in->lines);
+        free(in->buf);
+        free(in->str);
+        return 0;
+    }
+    in->c = ',';
+    in->params = ",;|";
+    in->needle = "needle";
+    if (strcmp(in->kind, "adversarial-a") == 0) {
+        memset(in->str, 'a', len);
+        in->needle = "aaaaaaaaaaaaaaaaaaaaaaaaaaaaaaab";
+    } else if (strcmp(in->kind, "adversarial-ab") == 0) {
+        for (size_t i = 0; i < len; i++)
+            in->str[i] = "ab"[i & 1];
+        in->needle = "abababababababababababababababac";
+    } else {
+        for (size_t i = 0; i < len; i++) {
+            uint64_t r = next_rand();
+            in->str[i] = (r & 15) == 0 ? ' ' : letters[(r >> 4) % (sizeof(letters) - 1)];
+        }
+        size_t every = KINDS[kind].every;
+        for (size_t i = every; every != 0 && i + 7 <= len; i += every)
+            memcpy(in->str + i - 7, "needle,", 7);
+    }
+    in->str[len] = '\0';
+    in->view = sv_fromn(in->str, len);
+    in->nview = sv_from(in->needle);
+    in->cs = charset_from(in->params);
+    in->cn = compile_needle(in->needle);
+    in->mp = compile_patterns(PATTERNS, 3);
+    in->reps = REPS;
+    memcpy(in->buf, in->str, len + 1);
+    in->file = tmpfile();
+    fwrite(in->str, 1, len, in->file);
+    fflush(in->file);
+    strcpy(in->path, "/tmp/stringutils_benchXXXXXX");
+    int fd = mkstemp(in->path);
+    if (write(fd, in->str, len) != (ssize_t)len)
+        fprintf(stderr, "couldn't write %s\n", in->path);
+    close(fd);
+    in->mf = map_file(in->path);
+    in->rope = rope_from(sv_fromn(in->str, 0));
+    for (size_t i = 0; i < len; i += 1024)
+        rope_append(in->rope, sv_fromn(in->str + i, len - i < 1024 ? len - i : 1024));
+    in->glob = compile_glob("*[a-m]?e*needle,*", GlobDefault);
+    in->hist = histogram_create(0);
+    histogram_count(in->hist, in->view, sep_whitespace());
+    char* text = (char*)(in->lines + in->nlines);
+    for (int i = 0; i < in->nlines; i++) {
+        in->lines[i] = text + (size_t)i * 32;
+        memcpy(in->lines[i], in->str + (size_t)i * 32, 31);
+        in->lines[i][31] = '\0';
+    }
+    // Numbers look like CSV columns: up to 9 integer digits, up to 8 decimals, now and then an exponent
+    in->nnumbers = 0;
+    for (size_t at = 0; at + 30 <= len; in->nnumbers++) {
+        uint64_t r = next_rand();
+        int w = snprintf(in->numbers + at, 32, "%s%llu", r & 1 ? "-" : "", (unsigned long long)(r >> 8) % 1000000000ULL >> (r >> 1 & 31));
+        in->ifields[in->nnumbers] = sv_fromn(in->numbers + at, w);
+        w += snprintf(in->numbers + at + w, 32, ".%0*llu", (int)(r >> 6 & 7) + 1, (unsigned long long)(r >> 20) % 100000000ULL);
+        if ((r >> 9 & 15) == 0)
+            w += snprintf(in->numbers + at + w, 32, "e%d", (int)(r >> 12 & 63) - 32);
+        in->dfields[in->nnumbers] = sv_fromn(in->numbers + at, w);
+        in->values[in->nnumbers] = strtod(in->numbers + at, NULL);
+        at += w;
+        in->numbers[at++] = ',';
+    }
+    return 1;
+}
+
+static void free_input(bench_input* in) {
+    free(in->ints);
+    free(in->values);
+    free(in->ifields);
+    free(in->dfields);
+    free(in->numbers);
+    free(in->results);
+    free(in->lines);
+    histogram_free(in->hist);
+    free_glob(in->glob);
+    rope_free(in->rope);
+    unmap_file(in->mf);
+    unlink(in->path);
+    fclose(in->file);
+    free_patterns(in->mp);
+    free_needle(in->cn);
+    free(in->buf);
+    free(in->str);
+}
+
+static size_t parse_size(const char* arg) {
+    char* end;
+    size_t size = strtoull(arg, &end, 10);
+    switch (*end) {
+        case 'G': case 'g': size <<= 30; break;
+        case 'M': case 'm': size <<= 20; break;
+        case 'K': case 'k': size <<= 10; break;
+    }
+    return size;
+}
+
+int main(int argc, char** argv) {
+    size_t min_size = 16, max_size = 64 << 20;
+    double min_time = 20e6;
+    const char* filter = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--min-size") == 0 && i + 1 < argc)
+            min_size = parse_size(argv[++i]);
+        else if (strcmp(argv[i], "--max-size") == 0 && i + 1 < argc)
+            max_size = parse_size(argv[++i]);
+        else if (strcmp(argv[i], "--min-time-ms") == 0 && i + 1 < argc)
+            min_time = atof(argv[++i]) * 1e6;
+        else if (strcmp(argv[i], "--filter") == 0 && i + 1 < argc)
+            filter = argv[++i];
+        else {
+            fprintf(stderr, "usage: %s [--min-size 16] [--max-size 64M] [--min-time-ms 20] [--filter name]\n", argv[0]);
+            return 1;
+        }
+    }
+    unsigned long long sink = 0;
+    int first = 1;
+    printf("{\"results\": [\n");
+    for (size_t len = min_size; len <= max_size; len *= 4) {
+        for (size_t kind = 0; kind < sizeof(KINDS) / sizeof(KINDS[0]); kind++) {
+            bench_input in;
+            if (!make_input(&in, kind, len)) {
+                fprintf(stderr, "skipping %zu bytes, the inputs don't fit in memory\n", len);
+                break;
+            }
+            for (size_t c = 0; c < sizeof(CASES) / sizeof(CASES[0]); c++) {
+                if (filter != NULL && strstr(CASES[c].name, filter) == NULL)
+                    continue;
+                fprintf(stderr, "%s %s %zu\n", CASES[c].name, in.kind, len);
+                reset_peak_rss();
+                int parallel = strncmp(CASES[c].name, "parallel_", 9) == 0;
+                if (parallel) {
+                    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+                    parallel_init_stringutils(cpus > 2 ? (int)cpus : 2, PARALLEL_BENCH_CHUNK);
+                }
+                // Double the batch until it runs for long enough, the registry is emptied between batches (untimed)
+                unsigned long long iterations = 1, allocs;
+                double elapsed;
+                for (;;) {
+                    unsigned long long before = registry_allocs();
+                    double start = now_ns();
+                    for (unsigned long long i = 0; i < iterations; i++)
+                        sink += (unsigned long long)CASES[c].run(&in);
+                    elapsed = now_ns() - start;
+                    allocs = registry_allocs() - before;
+                    free_all_stringutils_structures();
+                    if (elapsed >= min_time)
+                        break;
+                    iterations *= 2;
+                }
+                if (parallel)
+                    parallel_init_stringutils(1, 0);
+                printf("%s  {\"function\": \"%s\", \"input\": \"%s\", \"size\": %zu, \"iterations\": %llu, "
+                       "\"ns_per_call\": %.3f, \"ns_per_byte\": %.5f, \"allocs_per_call\": %.3f, \"peak_rss_kb\": %ld}",
+                       first ? "" : ",\n", CASES[c].name, in.kind, len, iterations, elapsed / iterations,
+                       elapsed / iterations / len, (double)allocs / iterations, peak_rss_kb());
+                fflush(stdout);
+                first = 0;
+            }
+            free_input(&in);
+        }
+    }
+    printf("\n], \"sink\": %llu}\n", sink);
+    return 0;
+}
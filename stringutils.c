@@ -1,154 +1,3619 @@
 #include "stringutils.h"
+#include <errno.h>
+#include <float.h>
+#include <limits.h>
+#include <locale.h>
+#include <math.h>
+#ifdef _WIN32
+    #include <io.h>
+    #define READ_FD(fd, buf, n) _read(fd, buf, (unsigned int)(n))
+#else
+    #include <unistd.h>
+    #include <pthread.h>
+    #define PARALLEL_POOL       // Big buffers can be split between the threads of a pool, see parallel_init_stringutils()
+    #include <fcntl.h>
+    #include <sys/mman.h>
+    #include <sys/stat.h>
+    #define READ_FD(fd, buf, n) read(fd, buf, n)
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+    #include <immintrin.h>
+    #define X86_SIMD        // The best kernels for the running cpu get picked by select_kernels()
+#endif
+
+#define MAX_STRINGS 1000
+#ifndef SIGUSR1
+#define SIGUSR1 SIGTERM     // For some reason Windows doesn't let you use user defined errors.
+#endif
+#define MAX_VECT 500
+#define ARENA_CHUNK 65536
+#define ARENA_ALIGN sizeof(void*)
+#define HEADER(ptr) ((alloc_header*)(ptr) - 1)
+#define ALLOC_ARENA 1       // Lives in an arena, never freed on its own
+#define ALLOC_DETACHED 2    // Not in the internal structs, owned by the user
+#define ALLOC_INTERNED 4    // Owned by the intern table, only freed by clear_interned_stringutils()
+#define INTERN_SLOTS 64     // Starting size of the intern table, always a power of 2
+#define ROPE_STOP ((size_t)-1)  // Returned by the callbacks of rope_scan() to end the scan
+#define HISTOGRAM_SLOTS 64  // Smallest hash table of a token_histogram, always a power of 2
+#define CS_HAS(cs, c) (((cs)->bits[(unsigned char)(c) >> 3] >> ((unsigned char)(c) & 7)) & 1)
+#define SHORT_NEEDLE 32     // Needles up to this length are searched with the first/last byte filter instead of Two-Way
+#define PAIR_BUDGET 16       // Long needles can be compared this many times (plus once every len bytes) before Two-Way kicks in
+#define NEEDLE_FORWARD 1
+#define NEEDLE_REVERSE 2
+#define TOKENIZER_BUFFER 65536
+#define PARALLEL_CHUNK 1048576  // Default for the smallest chunk of a buffer worth handing to another thread
+#define COMPACT_BLOCK 4096  // Bytes compacted at a time when the output might not fit the caller's buffer
+#define ICASE_WINDOW 4096   // Bytes of haystack lowercased at a time by the case insensitive search
+#define REPLACE_BATCH 256   // Match offsets remembered by replace() between counting and copying
+#define MAX_DFA_ENTRIES (1 << 24)   // Bigger automatons follow failure links at search time instead
+#define GLOB_MAX_WORDS 64   // Glob states are at most this many 64 bit words, so they fit on the stack
+#define GLOB_HAS(set, s) (((set)[(s) >> 6] >> ((s) & 63)) & 1)
+#define POW10_MIN (-348)    // Range of the powers of ten kept with a 128 bit mantissa for float parsing
+#define POW10_MAX 347
+#define POW10_LIMBS 36      // 32 bit limbs of the big numbers those mantissas are computed from
+#define str char*
+#define vstr char**
+#define uint unsigned int
+#define ulint unsigned long int
+#define ll long long
+#define p(name) (*name)
+#define tp(type, name) type *name
+
+#ifdef STRINGUTILS_PER_THREAD   // Every thread gets its own structs/vstructs/arena, see README.
+    #if defined(_MSC_VER)
+        #define THREAD_LOCAL __declspec(thread)
+    #elif defined(__GNUC__)
+        #define THREAD_LOCAL __thread
+    #else
+        #define THREAD_LOCAL _Thread_local
+    #endif
+    #if !defined(_MSC_VER) && !defined(__STDC_NO_ATOMICS__)
+        #define ATOMIC _Atomic
+    #endif
+    #ifndef _WIN32
+        #include <pthread.h>
+        #define THREAD_EXIT_HOOK
+    #endif
+#endif
+#ifndef THREAD_LOCAL
+    #define THREAD_LOCAL
+#endif
+#ifndef ATOMIC
+    #define ATOMIC
+#endif
+
+#ifdef STRINGUTILS_PROFILE      // Per function statistics, recorded while the trace level is Profile (see README)
+    #ifndef __GNUC__
+        #error "STRINGUTILS_PROFILE needs GCC or clang"
+    #endif
+    #ifdef STRINGUTILS_PER_THREAD
+        #define PROFILE_ADD(field, n) __atomic_fetch_add(&(field), (n), __ATOMIC_RELAXED)
+    #else
+        #define PROFILE_ADD(field, n) ((field) += (n))
+    #endif
+    #include <time.h>
+    #define PROFILE_LEN(string) ((string) != NULL ? strlen(string) : 0)
+    // Only the outermost library call is recorded, bytes are only evaluated if the call is being recorded
+    #define PROFILE_SCOPE(n) \
+        static stringutils_profile_entry PROFILE_ENTRY = { .function = __func__ }; \
+        profile_scope PROFILE_CURRENT_SCOPE __attribute__((cleanup(profile_end))) = profile_begin(&PROFILE_ENTRY); \
+        if (PROFILE_CURRENT_SCOPE.entry != NULL) \
+            PROFILE_ADD(PROFILE_ENTRY.bytes, (n))
+    #define PROFILE_ALLOC(size) \
+        if (PROFILE_CURRENT != NULL) \
+            PROFILE_ADD(PROFILE_CURRENT->allocated, (size))
+#else
+    #define PROFILE_SCOPE(n)
+    #define PROFILE_ALLOC(size)
+#endif
+
+THREAD_LOCAL alloced_strings structs = { NULL, 0, 0};
+THREAD_LOCAL alloced_vects vstructs = { NULL, 0, 0};
+THREAD_LOCAL stringutils_arena* ARENA = NULL;
+THREAD_LOCAL unsigned long long ROPE_SEED = 0x9E3779B97F4A7C15ULL;
+ATOMIC ll INIT_STRINGS = MAX_STRINGS;
+ATOMIC ll INIT_VECT = MAX_VECT;
+ATOMIC int SIGNAL_USR_StringUtils = 0;
+ATOMIC StringUtilsTraceLvl TRACE_LVL = NoTrace;
+ATOMIC int INTERN_ON_SPLIT = 0;
+#ifdef STRINGUTILS_PROFILE
+typedef struct profile_scope {
+    stringutils_profile_entry* entry;
+    unsigned long long start;
+    int counted;
+} profile_scope;
+
+stringutils_profile_entry* PROFILE_HEAD = NULL;
+THREAD_LOCAL stringutils_profile_entry* PROFILE_CURRENT = NULL;
+THREAD_LOCAL int PROFILE_DEPTH = 0;
+char PROFILE_DUMP_PATH[4096] = "";
+#endif
+
+typedef struct char_kernels {
+    ll (*findc)(const char* ptr, size_t len, char c);
+    ll (*rfindc)(const char* ptr, size_t len, char c);
+    ll (*countc)(const char* ptr, size_t len, char c);
+    void (*replacec)(char* ptr, size_t len, char needle, char rep);
+    ll (*findpair)(const char* haystack, size_t len, const char* needle, size_t m, size_t* budget);
+    ll (*findcs)(const char* ptr, size_t len, const charset* cs);
+    ll (*rfindcs)(const char* ptr, size_t len, const charset* cs);
+    ll (*countcs)(const char* ptr, size_t len, const charset* cs);
+    size_t (*compactcs)(char* dst, const char* src, size_t len, const charset* cs, int runs, int prev);
+    void (*casemap)(char* dst, const char* src, size_t len, char first, char last);
+    unsigned long long (*csvblock)(const char* block, char delim, unsigned long long* inside);
+} char_kernels;
+
+typedef struct replace_plan {
+    compiled_needle cn;
+    size_t offsets[REPLACE_BATCH];
+    size_t stored;
+    size_t matches;
+    size_t len;
+} replace_plan;
+
+typedef struct icase_search {
+    compiled_needle cn;     // over the lowercased needle
+    str mem;                // lowercased needle followed by the window
+    str window;
+    size_t cap;             // size of window
+    size_t base;            // index in the haystack of the first byte of window
+    size_t filled;          // bytes of haystack in window, 0 when it holds nothing
+    char buf[2 * ICASE_WINDOW];
+} icase_search;
+
+typedef struct batch_args {
+    char c;
+    char rep;
+    charset cs;
+    char* needle;
+    char* with;
+} batch_args;
+
+typedef struct parallel_ctx {
+    const char* src;
+    char* dst;
+    size_t len;
+    size_t chunk;           // bytes per chunk, the last one can be shorter
+    char c;
+    char rep;
+    const compiled_needle* cn;
+    strview with;
+    ll* counts;
+    size_t* starts;
+    size_t* ends;
+    size_t* out;
+} parallel_ctx;
+
+#ifdef PARALLEL_POOL
+typedef struct parallel_job {
+    void (*run)(parallel_ctx* ctx, size_t chunk);
+    parallel_ctx* ctx;
+    size_t chunks;
+    size_t next;            // next chunk to be picked up
+    size_t done;            // chunks completed
+} parallel_job;
+
+typedef struct thread_pool {
+    pthread_t* threads;
+    int count;              // read without the locks by parallel_chunks(), always accessed atomically
+    pthread_mutex_t submit; // held by the thread whose job is running
+    pthread_mutex_t lock;
+    pthread_cond_t wake;
+    pthread_cond_t finished;
+    parallel_job* job;
+    unsigned long long generation;
+    int active;             // workers currently inside job
+    int stop;
+} thread_pool;
+
+thread_pool POOL = { NULL, 0, PTHREAD_MUTEX_INITIALIZER, PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, PTHREAD_COND_INITIALIZER, NULL, 0, 0, 0 };
+size_t PARALLEL_MIN = PARALLEL_CHUNK;
+void pool_shutdown(void);
+#endif
+
+// Every string and list of strings handed out by the library is preceded by one of these
+typedef struct alloc_header {
+    size_t index;           // position in structs.strings/vstructs.vectors
+    unsigned int count;     // number of strings (lists of strings only)
+    unsigned int flags;
+} alloc_header;
+
+typedef struct intern_slot {
+    unsigned long long hash;
+    size_t len;
+    str ptr;                // NULL for an empty slot
+} intern_slot;
+
+typedef struct intern_table {
+    intern_slot* slots;
+    size_t cap;
+    size_t count;
+    stringutils_arena* arena;   // backing storage of every interned string
+} intern_table;
+
+THREAD_LOCAL intern_table INTERNED = { NULL, 0, 0, NULL };
+
+char_kernels KERNELS = { NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL };
+void select_kernels(void);
+void fill_pow10(void);
+#define KERNEL(name) (KERNELS.name != NULL ? KERNELS.name : (select_kernels(), KERNELS.name))
+
+#ifdef __GNUC__             // __attribute__((constructor)) is only present in GCC, therefore we need to check this.
+    #ifndef __clang__
+void init(void) __attribute__((constructor));
+
+void init(void) {
+    select_kernels();
+    fill_pow10();
+    atexit(free_all_stringutils_structures);
+#ifdef PARALLEL_POOL
+    atexit(pool_shutdown);
+#endif
+}
+    #endif
+#endif
+
+void* arena_alloc(stringutils_arena* arena, size_t size);
+size_t put_clamped(str dst, size_t cap, size_t at, const char* src, size_t len);
+
+#ifdef THREAD_EXIT_HOOK
+pthread_key_t thread_exit_key;
+pthread_once_t thread_exit_once = PTHREAD_ONCE_INIT;
+THREAD_LOCAL int thread_exit_armed = 0;
+
+void thread_exit_free(void* _) {
+    (void)_;
+    free_all_stringutils_structures();
+}
+
+void thread_exit_key_init(void) {
+    pthread_key_create(&thread_exit_key, thread_exit_free);
+}
+
+void arm_thread_exit(void) {
+    if (thread_exit_armed)
+        return;
+    pthread_once(&thread_exit_once, thread_exit_key_init);
+    pthread_setspecific(thread_exit_key, (void*)1);
+    thread_exit_armed = 1;
+}
+#else
+#define arm_thread_exit()
+#endif
+
+void register_string(str ptr) {
+    if (structs.strings == NULL) {
+        arm_thread_exit();
+        if (structs.max_size == 0)
+            structs.max_size = INIT_STRINGS;
+        structs.strings = malloc(sizeof(vstr)*structs.max_size);
+    } else if (structs.max_size == structs.contains) {
+        structs.max_size *= 2;
+        structs.strings = realloc(structs.strings, sizeof(vstr)*structs.max_size);
+    }
+    HEADER(ptr)->index = structs.contains;
+    HEADER(ptr)->flags &= ~ALLOC_DETACHED;
+    structs.strings[structs.contains] = ptr;
+    structs.contains++;
+}
+
+void register_vect(vstr vect) {
+    if (vstructs.vectors == NULL) {
+        arm_thread_exit();
+        if (vstructs.max_size == 0)
+            vstructs.max_size = INIT_VECT;
+        vstructs.vectors = malloc(sizeof(vstr*)*vstructs.max_size);
+    } else if (vstructs.max_size == vstructs.contains) {
+        vstructs.max_size *= 2;
+        vstructs.vectors = realloc(vstructs.vectors, sizeof(vstr*)*vstructs.max_size);
+    }
+    HEADER(vect)->index = vstructs.contains;
+    HEADER(vect)->flags &= ~ALLOC_DETACHED;
+    vstructs.vectors[vstructs.contains] = vect;
+    vstructs.contains++;
+}
+
+// Both return 0 if ptr isn't held by the internal structs of the calling thread
+int unregister_string(str ptr) {
+    size_t i = HEADER(ptr)->index;
+    if (HEADER(ptr)->flags != 0 || i >= structs.contains || structs.strings[i] != ptr)
+        return 0;
+    str last = structs.strings[--structs.contains];
+    structs.strings[i] = last;
+    HEADER(last)->index = i;
+    if (structs.max_size > (unsigned long long)INIT_STRINGS && structs.contains < structs.max_size / 4) {
+        structs.max_size /= 2;
+        structs.strings = realloc(structs.strings, sizeof(vstr)*structs.max_size);
+    }
+    return 1;
+}
+
+int unregister_vect(vstr vect) {
+    size_t i = HEADER(vect)->index;
+    if (HEADER(vect)->flags != 0 || i >= vstructs.contains || vstructs.vectors[i] != vect)
+        return 0;
+    vstr last = vstructs.vectors[--vstructs.contains];
+    vstructs.vectors[i] = last;
+    HEADER(last)->index = i;
+    if (vstructs.max_size > (unsigned long long)INIT_VECT && vstructs.contains < vstructs.max_size / 4) {
+        vstructs.max_size /= 2;
+        vstructs.vectors = realloc(vstructs.vectors, sizeof(vstr*)*vstructs.max_size);
+    }
+    return 1;
+}
+
+void handle_err(StringUtilsErrors error_type, const char *_Format, ...) {
+    va_list args;
+    va_start(args, _Format);
+    if (!SIGNAL_USR_StringUtils) {
+        vprintf(_Format, args);
+        exit(error_type);
+    }
+    else {
+        if (TRACE_LVL != NoTrace)
+            fprintf(stderr,"[Warn: triggered exception handled by the user] Err: %s\n", errcodetostr_stringutils(error_type));
+        raise(SIGUSR1);
+    }
+    va_end(args);
+}
+
+#ifdef STRINGUTILS_PROFILE
+unsigned long long profile_ticks(void) {
+#ifdef X86_SIMD
+    return __rdtsc();
+#else
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+#endif
+}
+
+profile_scope profile_begin(stringutils_profile_entry* entry) {
+    profile_scope scope = { NULL, 0, 0 };
+    if (TRACE_LVL != Profile)
+        return scope;
+    scope.counted = 1;
+    if (PROFILE_DEPTH++ > 0)
+        return scope;
+    if (!__atomic_exchange_n(&entry->registered, 1, __ATOMIC_ACQ_REL)) {
+        entry->next = __atomic_load_n(&PROFILE_HEAD, __ATOMIC_ACQUIRE);
+        while (!__atomic_compare_exchange_n(&PROFILE_HEAD, &entry->next, entry, 1, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE))
+            ;
+    }
+    PROFILE_CURRENT = entry;
+    scope.entry = entry;
+    scope.start = profile_ticks();
+    return scope;
+}
+
+void profile_end(profile_scope* scope) {
+    if (!scope->counted)
+        return;
+    PROFILE_DEPTH--;
+    if (scope->entry == NULL)
+        return;
+    unsigned long long ticks = profile_ticks() - scope->start;
+    PROFILE_ADD(scope->entry->calls, 1);
+    PROFILE_ADD(scope->entry->ticks, ticks);
+    PROFILE_ADD(scope->entry->histogram[63 - __builtin_clzll(ticks | 1)], 1);
+    PROFILE_CURRENT = NULL;
+}
+#endif
+
+ll findc_scalar(const char* ptr, size_t len, char c) {
+    for (size_t i = 0; i < len; i++)
+        if (ptr[i] == c)
+            return i;
+    return -1;
+}
+ll rfindc_scalar(const char* ptr, size_t len, char c) {
+    for (size_t i = len; i > 0; i--)
+        if (ptr[i-1] == c)
+            return i-1;
+    return -1;
+}
+ll countc_scalar(const char* ptr, size_t len, char c) {
+    ll n = 0;
+    for (size_t i = 0; i < len; i++)
+        n += ptr[i] == c;
+    return n;
+}
+void replacec_scalar(char* ptr, size_t len, char needle, char rep) {
+    for (size_t i = 0; i < len; i++)
+        if (ptr[i] == needle)
+            ptr[i] = rep;
+}
+// Flips the case of the bytes between first and last, ('A', 'Z') lowercases and ('a', 'z') uppercases, dst can be src
+void casemap_scalar(char* dst, const char* src, size_t len, char first, char last) {
+    unsigned char span = (unsigned char)(last - first);
+    for (size_t i = 0; i < len; i++)
+        dst[i] = src[i] ^ (((unsigned char)(src[i] - first) <= span) << 5);
+}
+ll findpair_scalar(const char* haystack, size_t len, const char* needle, size_t m, size_t* budget) {
+    if (m > len)
+        return -1;
+    const char* end = haystack + len - m + 1;
+    const char* ptr = haystack;
+    while ((ptr = memchr(ptr, needle[0], end - ptr)) != NULL) {
+        if (ptr[m-1] == needle[m-1]) {
+            if (budget != NULL) {
+                if (*budget < m) { *budget = ptr - haystack; return -2; }
+                *budget -= m;
+            }
+            if (memcmp(ptr+1, needle+1, m-2) == 0)
+                return ptr - haystack;
+        }
+        ptr++;
+    }
+    return -1;
+}
+
+ll findcs_scalar(const char* ptr, size_t len, const charset* cs) {
+    for (size_t i = 0; i < len; i++)
+        if (CS_HAS(cs, ptr[i]))
+            return i;
+    return -1;
+}
+ll rfindcs_scalar(const char* ptr, size_t len, const charset* cs) {
+    for (size_t i = len; i > 0; i--)
+        if (CS_HAS(cs, ptr[i-1]))
+            return i-1;
+    return -1;
+}
+ll countcs_scalar(const char* ptr, size_t len, const charset* cs) {
+    ll n = 0;
+    for (size_t i = 0; i < len; i++)
+        n += CS_HAS(cs, ptr[i]);
+    return n;
+}
+// Copies the bytes of src that aren't in cs to dst and returns how many were kept, dst can be src.
+// With runs set, only the bytes in cs that follow another one are dropped (prev tells if the byte before src was in cs, both are 0 or 1).
+size_t compactcs_scalar(char* dst, const char* src, size_t len, const charset* cs, int runs, int prev) {
+    size_t n = 0;
+    for (size_t i = 0; i < len; i++) {
+        int in = CS_HAS(cs, src[i]);
+        dst[n] = src[i];
+        n += !(in & ((runs ^ 1) | prev));
+        prev = in;
+    }
+    return n;
+}
+// Quotes flip the state, so the bytes inside quotes are the prefix xor of the quote bits. inside carries the state over
+// from the previous block (0 or all ones). Returns the delimiters and newlines of a 64 byte block that are outside quotes.
+unsigned long long csv_outside(unsigned long long quoted, unsigned long long structural, unsigned long long* inside) {
+    quoted ^= *inside;
+    *inside = 0 - (quoted >> 63);
+    return structural & ~quoted;
+}
+unsigned long long csvblock_scalar(const char* block, char delim, unsigned long long* inside) {
+    unsigned long long quotes = 0, structural = 0;
+    for (int i = 0; i < 64; i++) {
+        quotes |= (unsigned long long)(block[i] == '"') << i;
+        structural |= (unsigned long long)(block[i] == delim || block[i] == '\n') << i;
+    }
+    for (int shift = 1; shift < 64; shift *= 2)
+        quotes ^= quotes << shift;
+    return csv_outside(quotes, structural, inside);
+}
+
+#ifdef X86_SIMD
+__attribute__((target("sse2")))
+ll findc_sse2(const char* ptr, size_t len, char c) {
+    __m128i needle = _mm_set1_epi8(c);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        uint mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(ptr+i)), needle));
+        if (mask)
+            return i + __builtin_ctz(mask);
+    }
+    ll r = findc_scalar(ptr+i, len-i, c);
+    return r == -1 ? -1 : (ll)i + r;
+}
+__attribute__((target("sse2")))
+ll rfindc_sse2(const char* ptr, size_t len, char c) {
+    __m128i needle = _mm_set1_epi8(c);
+    size_t i = len;
+    for (; i >= 16; i -= 16) {
+        uint mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(ptr+i-16)), needle));
+        if (mask)
+            return i - 16 + 31 - __builtin_clz(mask);
+    }
+    return rfindc_scalar(ptr, i, c);
+}
+__attribute__((target("sse2")))
+ll countc_sse2(const char* ptr, size_t len, char c) {
+    __m128i needle = _mm_set1_epi8(c), zero = _mm_setzero_si128(), total = zero;
+    size_t i = 0;
+    while (i + 16 <= len) {
+        __m128i acc = zero;     // 8 bit counters, flushed before they can overflow
+        for (int k = 0; k < 255 && i + 16 <= len; k++, i += 16)
+            acc = _mm_sub_epi8(acc, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(ptr+i)), needle));
+        total = _mm_add_epi64(total, _mm_sad_epu8(acc, zero));
+    }
+    ll sums[2];
+    _mm_storeu_si128((__m128i*)sums, total);
+    return sums[0] + sums[1] + countc_scalar(ptr+i, len-i, c);
+}
+__attribute__((target("sse2")))
+void replacec_sse2(char* ptr, size_t len, char needle, char rep) {
+    __m128i n = _mm_set1_epi8(needle), r = _mm_set1_epi8(rep);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(ptr+i));
+        __m128i m = _mm_cmpeq_epi8(x, n);
+        _mm_storeu_si128((__m128i*)(ptr+i), _mm_or_si128(_mm_andnot_si128(m, x), _mm_and_si128(m, r)));
+    }
+    replacec_scalar(ptr+i, len-i, needle, rep);
+}
+
+__attribute__((target("sse2")))
+void casemap_sse2(char* dst, const char* src, size_t len, char first, char last) {
+    // Unsigned range check with signed compares: shift the range so it starts at -128
+    __m128i shift = _mm_set1_epi8((char)(-128 - first)), limit = _mm_set1_epi8((char)(-128 + (last - first) + 1)), flip = _mm_set1_epi8(0x20);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(src+i));
+        __m128i in = _mm_cmplt_epi8(_mm_add_epi8(x, shift), limit);
+        _mm_storeu_si128((__m128i*)(dst+i), _mm_xor_si128(x, _mm_and_si128(in, flip)));
+    }
+    casemap_scalar(dst+i, src+i, len-i, first, last);
+}
+__attribute__((target("sse2")))
+ll findpair_sse2(const char* haystack, size_t len, const char* needle, size_t m, size_t* budget) {
+    // Only the positions where both the first and the last byte of needle match get compared in full.
+    // Every comparison costs m bytes of budget (if any), once it runs out the position is stored in it and -2 is returned.
+    __m128i first = _mm_set1_epi8(needle[0]), last = _mm_set1_epi8(needle[m-1]);
+    size_t i = 0;
+    for (; i + m - 1 + 16 <= len; i += 16) {
+        __m128i a = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(haystack+i)), first);
+        __m128i b = _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i*)(haystack+i+m-1)), last);
+        uint mask = _mm_movemask_epi8(_mm_and_si128(a, b));
+        while (mask) {
+            uint bit = __builtin_ctz(mask);
+            if (budget != NULL) {
+                if (*budget < m) { *budget = i + bit; return -2; }
+                *budget -= m;
+            }
+            if (memcmp(haystack+i+bit+1, needle+1, m-2) == 0)
+                return i + bit;
+            mask &= mask - 1;
+        }
+    }
+    ll r = findpair_scalar(haystack+i, len-i, needle, m, budget);
+    if (r == -2)
+        *budget += i;
+    return r < 0 ? r : (ll)i + r;
+}
+
+__attribute__((target("avx2")))
+ll findc_avx2(const char* ptr, size_t len, char c) {
+    __m256i needle = _mm256_set1_epi8(c);
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        uint mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(ptr+i)), needle));
+        if (mask)
+            return i + __builtin_ctz(mask);
+    }
+    ll r = findc_scalar(ptr+i, len-i, c);
+    return r == -1 ? -1 : (ll)i + r;
+}
+__attribute__((target("avx2")))
+ll rfindc_avx2(const char* ptr, size_t len, char c) {
+    __m256i needle = _mm256_set1_epi8(c);
+    size_t i = len;
+    for (; i >= 32; i -= 32) {
+        uint mask = _mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(ptr+i-32)), needle));
+        if (mask)
+            return i - 32 + 31 - __builtin_clz(mask);
+    }
+    return rfindc_scalar(ptr, i, c);
+}
+__attribute__((target("avx2")))
+ll countc_avx2(const char* ptr, size_t len, char c) {
+    __m256i needle = _mm256_set1_epi8(c), zero = _mm256_setzero_si256(), total = zero;
+    size_t i = 0;
+    while (i + 32 <= len) {
+        __m256i acc = zero;
+        for (int k = 0; k < 255 && i + 32 <= len; k++, i += 32)
+            acc = _mm256_sub_epi8(acc, _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(ptr+i)), needle));
+        total = _mm256_add_epi64(total, _mm256_sad_epu8(acc, zero));
+    }
+    ll sums[4];
+    _mm256_storeu_si256((__m256i*)sums, total);
+    return sums[0] + sums[1] + sums[2] + sums[3] + countc_scalar(ptr+i, len-i, c);
+}
+__attribute__((target("avx2")))
+void replacec_avx2(char* ptr, size_t len, char needle, char rep) {
+    __m256i n = _mm256_set1_epi8(needle), r = _mm256_set1_epi8(rep);
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(ptr+i));
+        _mm256_storeu_si256((__m256i*)(ptr+i), _mm256_blendv_epi8(x, r, _mm256_cmpeq_epi8(x, n)));
+    }
+    replacec_scalar(ptr+i, len-i, needle, rep);
+}
+
+__attribute__((target("avx2")))
+void casemap_avx2(char* dst, const char* src, size_t len, char first, char last) {
+    __m256i shift = _mm256_set1_epi8((char)(-128 - first)), limit = _mm256_set1_epi8((char)(-128 + (last - first))), flip = _mm256_set1_epi8(0x20);
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(src+i));
+        __m256i out = _mm256_cmpgt_epi8(_mm256_add_epi8(x, shift), limit);
+        _mm256_storeu_si256((__m256i*)(dst+i), _mm256_xor_si256(x, _mm256_andnot_si256(out, flip)));
+    }
+    // The tail runs legacy SSE code, entering it with dirty upper halves costs a state transition on every call
+    _mm256_zeroupper();
+    casemap_sse2(dst+i, src+i, len-i, first, last);
+}
+__attribute__((target("avx2")))
+ll findpair_avx2(const char* haystack, size_t len, const char* needle, size_t m, size_t* budget) {
+    __m256i first = _mm256_set1_epi8(needle[0]), last = _mm256_set1_epi8(needle[m-1]);
+    size_t i = 0;
+    for (; i + m - 1 + 32 <= len; i += 32) {
+        __m256i a = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(haystack+i)), first);
+        __m256i b = _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i*)(haystack+i+m-1)), last);
+        uint mask = _mm256_movemask_epi8(_mm256_and_si256(a, b));
+        while (mask) {
+            uint bit = __builtin_ctz(mask);
+            if (budget != NULL) {
+                if (*budget < m) { *budget = i + bit; return -2; }
+                *budget -= m;
+            }
+            if (memcmp(haystack+i+bit+1, needle+1, m-2) == 0)
+                return i + bit;
+            mask &= mask - 1;
+        }
+    }
+    ll r = findpair_scalar(haystack+i, len-i, needle, m, budget);
+    if (r == -2)
+        *budget += i;
+    return r < 0 ? r : (ll)i + r;
+}
+
+__attribute__((target("avx512f,avx512bw")))
+ll findc_avx512(const char* ptr, size_t len, char c) {
+    __m512i needle = _mm512_set1_epi8(c);
+    size_t i = 0;
+    for (; i + 64 <= len; i += 64) {
+        __mmask64 mask = _mm512_cmpeq_epi8_mask(_mm512_loadu_si512(ptr+i), needle);
+        if (mask)
+            return i + __builtin_ctzll(mask);
+    }
+    ll r = findc_avx2(ptr+i, len-i, c);
+    return r == -1 ? -1 : (ll)i + r;
+}
+__attribute__((target("avx512f,avx512bw")))
+ll rfindc_avx512(const char* ptr, size_t len, char c) {
+    __m512i needle = _mm512_set1_epi8(c);
+    size_t i = len;
+    for (; i >= 64; i -= 64) {
+        __mmask64 mask = _mm512_cmpeq_epi8_mask(_mm512_loadu_si512(ptr+i-64), needle);
+        if (mask)
+            return i - 64 + 63 - __builtin_clzll(mask);
+    }
+    return rfindc_avx2(ptr, i, c);
+}
+__attribute__((target("avx512f,avx512bw")))
+ll countc_avx512(const char* ptr, size_t len, char c) {
+    __m512i needle = _mm512_set1_epi8(c);
+    ll n = 0;
+    size_t i = 0;
+    for (; i + 64 <= len; i += 64)
+        n += __builtin_popcountll(_mm512_cmpeq_epi8_mask(_mm512_loadu_si512(ptr+i), needle));
+    return n + countc_avx2(ptr+i, len-i, c);
+}
+__attribute__((target("avx512f,avx512bw")))
+void replacec_avx512(char* ptr, size_t len, char needle, char rep) {
+    __m512i n = _mm512_set1_epi8(needle), r = _mm512_set1_epi8(rep);
+    size_t i = 0;
+    for (; i + 64 <= len; i += 64) {
+        __m512i x = _mm512_loadu_si512(ptr+i);
+        _mm512_storeu_si512(ptr+i, _mm512_mask_blend_epi8(_mm512_cmpeq_epi8_mask(x, n), x, r));
+    }
+    replacec_avx2(ptr+i, len-i, needle, rep);
+}
+__attribute__((target("avx512f,avx512bw")))
+void casemap_avx512(char* dst, const char* src, size_t len, char first, char last) {
+    __m512i base = _mm512_set1_epi8(first), span = _mm512_set1_epi8(last - first), flip = _mm512_set1_epi8(0x20);
+    size_t i = 0;
+    for (; i + 64 <= len; i += 64) {
+        __m512i x = _mm512_loadu_si512(src+i);
+        __mmask64 in = _mm512_cmple_epu8_mask(_mm512_sub_epi8(x, base), span);
+        _mm512_storeu_si512(dst+i, _mm512_mask_blend_epi8(in, x, _mm512_xor_si512(x, flip)));
+    }
+    casemap_avx2(dst+i, src+i, len-i, first, last);
+}
+
+// Set membership of 16 bytes at once: the low nibble picks a row of the table, the high nibble a bit of that row.
+// Rows for high nibbles 8-15 live in a second table, selected through the sign of each byte.
+__attribute__((target("ssse3")))
+uint charset_mask_ssse3(__m128i x, __m128i lo, __m128i hi, __m128i bitsel) {
+    __m128i nib = _mm_set1_epi8(0x0f);
+    __m128i low = _mm_and_si128(x, nib);
+    __m128i high = _mm_and_si128(_mm_srli_epi16(x, 4), nib);
+    __m128i neg = _mm_cmplt_epi8(x, _mm_setzero_si128());
+    __m128i row = _mm_or_si128(_mm_andnot_si128(neg, _mm_shuffle_epi8(lo, low)), _mm_and_si128(neg, _mm_shuffle_epi8(hi, low)));
+    __m128i bit = _mm_shuffle_epi8(bitsel, high);
+    return ~_mm_movemask_epi8(_mm_cmpeq_epi8(_mm_and_si128(row, bit), _mm_setzero_si128())) & 0xffff;
+}
+#define CHARSET_SSSE3_TABLES(cs) \
+    __m128i lo = _mm_loadu_si128((const __m128i*)(cs)->lo), hi = _mm_loadu_si128((const __m128i*)(cs)->hi); \
+    __m128i bitsel = _mm_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128)
+
+__attribute__((target("ssse3")))
+ll findcs_ssse3(const char* ptr, size_t len, const charset* cs) {
+    CHARSET_SSSE3_TABLES(cs);
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16) {
+        uint mask = charset_mask_ssse3(_mm_loadu_si128((const __m128i*)(ptr+i)), lo, hi, bitsel);
+        if (mask)
+            return i + __builtin_ctz(mask);
+    }
+    ll r = findcs_scalar(ptr+i, len-i, cs);
+    return r == -1 ? -1 : (ll)i + r;
+}
+__attribute__((target("ssse3")))
+ll rfindcs_ssse3(const char* ptr, size_t len, const charset* cs) {
+    CHARSET_SSSE3_TABLES(cs);
+    size_t i = len;
+    for (; i >= 16; i -= 16) {
+        uint mask = charset_mask_ssse3(_mm_loadu_si128((const __m128i*)(ptr+i-16)), lo, hi, bitsel);
+        if (mask)
+            return i - 16 + 31 - __builtin_clz(mask);
+    }
+    return rfindcs_scalar(ptr, i, cs);
+}
+__attribute__((target("ssse3")))
+ll countcs_ssse3(const char* ptr, size_t len, const charset* cs) {
+    CHARSET_SSSE3_TABLES(cs);
+    ll n = 0;
+    size_t i = 0;
+    for (; i + 16 <= len; i += 16)
+        n += __builtin_popcount(charset_mask_ssse3(_mm_loadu_si128((const __m128i*)(ptr+i)), lo, hi, bitsel));
+    return n + countcs_scalar(ptr+i, len-i, cs);
+}
+
+__attribute__((target("avx2")))
+uint charset_mask_avx2(__m256i x, __m256i lo, __m256i hi, __m256i bitsel) {
+    __m256i nib = _mm256_set1_epi8(0x0f);
+    __m256i low = _mm256_and_si256(x, nib);
+    __m256i high = _mm256_and_si256(_mm256_srli_epi16(x, 4), nib);
+    __m256i row = _mm256_blendv_epi8(_mm256_shuffle_epi8(lo, low), _mm256_shuffle_epi8(hi, low), x);
+    __m256i bit = _mm256_shuffle_epi8(bitsel, high);
+    return ~(uint)_mm256_movemask_epi8(_mm256_cmpeq_epi8(_mm256_and_si256(row, bit), _mm256_setzero_si256()));
+}
+#define CHARSET_AVX2_TABLES(cs) \
+    __m256i lo = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)(cs)->lo)); \
+    __m256i hi = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)(cs)->hi)); \
+    __m256i bitsel = _mm256_setr_epi8(1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128, \
+                                      1, 2, 4, 8, 16, 32, 64, -128, 1, 2, 4, 8, 16, 32, 64, -128)
+
+__attribute__((target("avx2")))
+ll findcs_avx2(const char* ptr, size_t len, const charset* cs) {
+    CHARSET_AVX2_TABLES(cs);
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32) {
+        uint mask = charset_mask_avx2(_mm256_loadu_si256((const __m256i*)(ptr+i)), lo, hi, bitsel);
+        if (mask)
+            return i + __builtin_ctz(mask);
+    }
+    ll r = findcs_scalar(ptr+i, len-i, cs);
+    return r == -1 ? -1 : (ll)i + r;
+}
+__attribute__((target("avx2")))
+ll rfindcs_avx2(const char* ptr, size_t len, const charset* cs) {
+    CHARSET_AVX2_TABLES(cs);
+    size_t i = len;
+    for (; i >= 32; i -= 32) {
+        uint mask = charset_mask_avx2(_mm256_loadu_si256((const __m256i*)(ptr+i-32)), lo, hi, bitsel);
+        if (mask)
+            return i - 32 + 31 - __builtin_clz(mask);
+    }
+    return rfindcs_scalar(ptr, i, cs);
+}
+__attribute__((target("avx2,popcnt")))
+ll countcs_avx2(const char* ptr, size_t len, const charset* cs) {
+    CHARSET_AVX2_TABLES(cs);
+    ll n = 0;
+    size_t i = 0;
+    for (; i + 32 <= len; i += 32)
+        n += __builtin_popcount(charset_mask_avx2(_mm256_loadu_si256((const __m256i*)(ptr+i)), lo, hi, bitsel));
+    return n + countcs_scalar(ptr+i, len-i, cs);
+}
+
+unsigned char COMPACT_SHUFFLE[256][8];  // for every mask of 8 kept bytes, the indices that move them to the front
+
+// Stores the bytes of x whose bit is set in keep back to back at dst, 8 bytes at a time
+__attribute__((target("ssse3")))
+size_t compact16_ssse3(char* dst, __m128i x, uint keep) {
+    __m128i lo = _mm_shuffle_epi8(x, _mm_loadl_epi64((const __m128i*)COMPACT_SHUFFLE[keep & 0xff]));
+    __m128i hi = _mm_shuffle_epi8(_mm_srli_si128(x, 8), _mm_loadl_epi64((const __m128i*)COMPACT_SHUFFLE[keep >> 8]));
+    size_t n = __builtin_popcount(keep & 0xff);
+    _mm_storel_epi64((__m128i*)dst, lo);
+    _mm_storel_epi64((__m128i*)(dst+n), hi);
+    return n + __builtin_popcount(keep >> 8);
+}
+
+// The vector versions store whole blocks, which only ever overwrite bytes of src that were already read
+__attribute__((target("ssse3")))
+size_t compactcs_ssse3(char* dst, const char* src, size_t len, const charset* cs, int runs, int prev) {
+    CHARSET_SSSE3_TABLES(cs);
+    size_t i = 0, n = 0;
+    uint carry = prev;
+    for (; i + 16 <= len; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(src+i));
+        uint in = charset_mask_ssse3(x, lo, hi, bitsel);
+        uint drop = runs ? in & ((in << 1) | carry) : in;
+        carry = in >> 15;
+        n += compact16_ssse3(dst+n, x, ~drop & 0xffff);
+    }
+    return n + compactcs_scalar(dst+n, src+i, len-i, cs, runs, carry);
+}
+__attribute__((target("avx2")))
+size_t compactcs_avx2(char* dst, const char* src, size_t len, const charset* cs, int runs, int prev) {
+    CHARSET_AVX2_TABLES(cs);
+    size_t i = 0, n = 0;
+    uint carry = prev;
+    for (; i + 32 <= len; i += 32) {
+        __m256i x = _mm256_loadu_si256((const __m256i*)(src+i));
+        uint in = charset_mask_avx2(x, lo, hi, bitsel);
+        uint keep = ~(runs ? in & ((in << 1) | carry) : in);
+        carry = in >> 31;
+        n += compact16_ssse3(dst+n, _mm256_castsi256_si128(x), keep & 0xffff);
+        n += compact16_ssse3(dst+n, _mm256_extracti128_si256(x, 1), keep >> 16);
+    }
+    return n + compactcs_scalar(dst+n, src+i, len-i, cs, runs, carry);
+}
+__attribute__((target("avx512f,avx512bw,avx512vbmi2")))
+size_t compactcs_avx512(char* dst, const char* src, size_t len, const charset* cs, int runs, int prev) {
+    CHARSET_AVX2_TABLES(cs);
+    size_t i = 0, n = 0;
+    unsigned long long carry = prev;
+    for (; i + 64 <= len; i += 64) {
+        __m512i x = _mm512_loadu_si512(src+i);
+        unsigned long long in = charset_mask_avx2(_mm512_castsi512_si256(x), lo, hi, bitsel)
+                              | (unsigned long long)charset_mask_avx2(_mm512_extracti64x4_epi64(x, 1), lo, hi, bitsel) << 32;
+        __mmask64 keep = ~(runs ? in & ((in << 1) | carry) : in);
+        carry = in >> 63;
+        _mm512_storeu_si512(dst+n, _mm512_maskz_compress_epi8(keep, x));
+        n += __builtin_popcountll(keep);
+    }
+    return n + compactcs_avx2(dst+n, src+i, len-i, cs, runs, (int)carry);
+}
+
+__attribute__((target("sse2")))
+void csv_masks_sse2(const char* block, char delim, unsigned long long* quotes, unsigned long long* structural) {
+    __m128i quote = _mm_set1_epi8('"'), sep = _mm_set1_epi8(delim), newline = _mm_set1_epi8('\n');
+    *quotes = *structural = 0;
+    for (int i = 0; i < 64; i += 16) {
+        __m128i x = _mm_loadu_si128((const __m128i*)(block+i));
+        *quotes |= (unsigned long long)(uint)_mm_movemask_epi8(_mm_cmpeq_epi8(x, quote)) << i;
+        *structural |= (unsigned long long)(uint)_mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(x, sep), _mm_cmpeq_epi8(x, newline))) << i;
+    }
+}
+__attribute__((target("sse2")))
+unsigned long long csvblock_sse2(const char* block, char delim, unsigned long long* inside) {
+    unsigned long long quotes, structural;
+    csv_masks_sse2(block, delim, &quotes, &structural);
+    for (int shift = 1; shift < 64; shift *= 2)
+        quotes ^= quotes << shift;
+    return csv_outside(quotes, structural, inside);
+}
+// A carry-less multiply by all ones is the prefix xor in a single instruction
+__attribute__((target("sse2,pclmul")))
+unsigned long long prefix_xor_pclmul(unsigned long long x) {
+    unsigned long long r;
+    _mm_storel_epi64((__m128i*)&r, _mm_clmulepi64_si128(_mm_set_epi64x(0, (ll)x), _mm_set1_epi8(-1), 0));
+    return r;
+}
+__attribute__((target("sse2,pclmul")))
+unsigned long long csvblock_pclmul(const char* block, char delim, unsigned long long* inside) {
+    unsigned long long quotes, structural;
+    csv_masks_sse2(block, delim, &quotes, &structural);
+    return csv_outside(prefix_xor_pclmul(quotes), structural, inside);
+}
+__attribute__((target("avx2,pclmul")))
+unsigned long long csvblock_avx2(const char* block, char delim, unsigned long long* inside) {
+    __m256i quote = _mm256_set1_epi8('"'), sep = _mm256_set1_epi8(delim), newline = _mm256_set1_epi8('\n');
+    __m256i lo = _mm256_loadu_si256((const __m256i*)block), hi = _mm256_loadu_si256((const __m256i*)(block+32));
+    unsigned long long quotes = (uint)_mm256_movemask_epi8(_mm256_cmpeq_epi8(lo, quote))
+                              | (unsigned long long)(uint)_mm256_movemask_epi8(_mm256_cmpeq_epi8(hi, quote)) << 32;
+    unsigned long long structural = (uint)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(lo, sep), _mm256_cmpeq_epi8(lo, newline)))
+                                  | (unsigned long long)(uint)_mm256_movemask_epi8(_mm256_or_si256(_mm256_cmpeq_epi8(hi, sep), _mm256_cmpeq_epi8(hi, newline))) << 32;
+    return csv_outside(prefix_xor_pclmul(quotes), structural, inside);
+}
+#endif
+
+void select_kernels(void) {
+    char_kernels kernels = { findc_scalar, rfindc_scalar, countc_scalar, replacec_scalar, findpair_scalar,
+                             findcs_scalar, rfindcs_scalar, countcs_scalar, compactcs_scalar, casemap_scalar, csvblock_scalar };
+#ifdef X86_SIMD
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512bw")) {
+        kernels.findc = findc_avx512; kernels.rfindc = rfindc_avx512;
+        kernels.countc = countc_avx512; kernels.replacec = replacec_avx512;
+        kernels.findpair = findpair_avx2;
+        kernels.casemap = casemap_avx512;
+    } else if (__builtin_cpu_supports("avx2")) {
+        kernels.findc = findc_avx2; kernels.rfindc = rfindc_avx2;
+        kernels.countc = countc_avx2; kernels.replacec = replacec_avx2;
+        kernels.findpair = findpair_avx2;
+        kernels.casemap = casemap_avx2;
+    } else if (__builtin_cpu_supports("sse2")) {
+        kernels.findc = findc_sse2; kernels.rfindc = rfindc_sse2;
+        kernels.countc = countc_sse2; kernels.replacec = replacec_sse2;
+        kernels.findpair = findpair_sse2;
+        kernels.casemap = casemap_sse2;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        kernels.findcs = findcs_avx2; kernels.rfindcs = rfindcs_avx2; kernels.countcs = countcs_avx2;
+        kernels.compactcs = compactcs_avx2;
+    } else if (__builtin_cpu_supports("ssse3")) {
+        kernels.findcs = findcs_ssse3; kernels.rfindcs = rfindcs_ssse3; kernels.countcs = countcs_ssse3;
+        kernels.compactcs = compactcs_ssse3;
+    }
+    if (__builtin_cpu_supports("avx512vbmi2"))
+        kernels.compactcs = compactcs_avx512;
+    if (__builtin_cpu_supports("pclmul"))
+        kernels.csvblock = __builtin_cpu_supports("avx2") ? csvblock_avx2 : csvblock_pclmul;
+    else if (__builtin_cpu_supports("sse2"))
+        kernels.csvblock = csvblock_sse2;
+    for (int mask = 0; mask < 256; mask++) {
+        int k = 0;
+        for (int bit = 0; bit < 8; bit++)
+            if (mask & (1 << bit))
+                COMPACT_SHUFFLE[mask][k++] = bit;
+        while (k < 8)
+            COMPACT_SHUFFLE[mask][k++] = 0x80;
+    }
+#endif
+    KERNELS = kernels;
+}
+
+
+void needle_init(compiled_needle* cn, const char* ptr, size_t len, int tables) {
+    const unsigned char* n = (const unsigned char*)ptr;
+    cn->ptr = ptr;
+    cn->len = len;
+    if ((tables & NEEDLE_FORWARD) && len > SHORT_NEEDLE) {
+        size_t ip, jp, k, p, ms, p0;
+        memset(cn->shift, 0, sizeof(cn->shift));
+        for (size_t i = 0; i < len; i++)
+            cn->shift[n[i]] = i+1;
+        // Two-Way critical factorization: maximal suffix for both orderings of the alphabet
+        ip = -1; jp = 0; k = p = 1;
+        while (jp+k < len) {
+            if (n[ip+k] == n[jp+k]) {
+                if (k == p) { jp += p; k = 1; }
+                else k++;
+            } else if (n[ip+k] > n[jp+k]) {
+                jp += k; k = 1; p = jp - ip;
+            } else {
+                ip = jp++; k = p = 1;
+            }
+        }
+        ms = ip;
+        p0 = p;
+        ip = -1; jp = 0; k = p = 1;
+        while (jp+k < len) {
+            if (n[ip+k] == n[jp+k]) {
+                if (k == p) { jp += p; k = 1; }
+                else k++;
+            } else if (n[ip+k] < n[jp+k]) {
+                jp += k; k = 1; p = jp - ip;
+            } else {
+                ip = jp++; k = p = 1;
+            }
+        }
+        if (ip+1 > ms+1) ms = ip;
+        else p = p0;
+        if (memcmp(n, n+p, ms+1) != 0) {
+            cn->memory = 0;
+            p = (ms > len-ms-1 ? ms : len-ms-1) + 1;
+        } else {
+            cn->memory = len - p;
+        }
+        cn->critical = ms;
+        cn->period = p;
+    }
+    if ((tables & NEEDLE_REVERSE) && len > 1) {
+        for (int c = 0; c < 256; c++)
+            cn->rshift[c] = len;
+        for (size_t j = len-1; j > 0; j--)
+            cn->rshift[n[j]] = j;
+    }
+}
+
+ll twoway(const compiled_needle* cn, const char* haystack, size_t hlen, ll* found) {
+    const unsigned char* h = (const unsigned char*)haystack;
+    const unsigned char* z = h + hlen;
+    const unsigned char* n = (const unsigned char*)cn->ptr;
+    size_t l = cn->len, ms = cn->critical, k, mem = 0;
+    while ((size_t)(z - h) >= l) {
+        size_t s = cn->shift[h[l-1]];
+        if (s == 0) {
+            h += l;
+            mem = 0;
+            continue;
+        }
+        k = l - s;
+        if (k) {
+            if (k < mem) k = mem;
+            h += k;
+            mem = 0;
+            continue;
+        }
+        for (k = ms+1 > mem ? ms+1 : mem; k < l && n[k] == h[k]; k++);
+        if (k < l) {
+            h += k - ms;
+            mem = 0;
+            continue;
+        }
+        for (k = ms+1; k > mem && n[k-1] == h[k-1]; k--);
+        if (k <= mem) {
+            if (found == NULL)
+                return h - (const unsigned char*)haystack;
+            (*found)++;
+        }
+        h += cn->period;
+        mem = cn->memory;
+    }
+    return found == NULL ? -1 : *found;
+}
+
+ll needle_find(const compiled_needle* cn, const char* haystack, size_t hlen) {
+    if (cn->len == 0)
+        return 0;
+    if (cn->len > hlen)
+        return -1;
+    if (cn->len == 1)
+        return KERNEL(findc)(haystack, hlen, cn->ptr[0]);
+    if (cn->len <= SHORT_NEEDLE)
+        return KERNEL(findpair)(haystack, hlen, cn->ptr, cn->len, NULL);
+    // The byte pair filter is tried first, Two-Way takes over if it starts producing too many false positives
+    size_t budget = hlen + PAIR_BUDGET*cn->len;
+    ll i = KERNEL(findpair)(haystack, hlen, cn->ptr, cn->len, &budget);
+    if (i != -2)
+        return i;
+    i = twoway(cn, haystack+budget, hlen-budget, NULL);
+    return i == -1 ? -1 : i + (ll)budget;
+}
+
+ll needle_rfind(const compiled_needle* cn, const char* haystack, size_t hlen) {
+    size_t m = cn->len;
+    const char* n = cn->ptr;
+    if (m > hlen)
+        return -1;
+    if (m == 0)
+        return hlen;
+    if (m == 1)
+        return KERNEL(rfindc)(haystack, hlen, n[0]);
+    size_t i = hlen - m;
+    for (;;) {
+        if (haystack[i] == n[0] && haystack[i+m-1] == n[m-1] && memcmp(haystack+i+1, n+1, m-2) == 0)
+            return i;
+        // Horspool in reverse: realign the first byte of the window with its leftmost occurrence in needle[1:]
+        size_t s = cn->rshift[(unsigned char)haystack[i]];
+        if (s > i)
+            return -1;
+        i -= s;
+    }
+}
+
+ll needle_count(const compiled_needle* cn, const char* haystack, size_t hlen) {
+    ll n = 0;
+    if (cn->len == 0 || cn->len > hlen)
+        return 0;
+    if (cn->len == 1)
+        return KERNEL(countc)(haystack, hlen, cn->ptr[0]);
+    size_t budget = hlen + PAIR_BUDGET*cn->len, pos = 0;
+    size_t* limit = cn->len > SHORT_NEEDLE ? &budget : NULL;
+    ll i;
+    while ((i = KERNEL(findpair)(haystack+pos, hlen-pos, cn->ptr, cn->len, limit)) >= 0) {
+        n++;
+        pos += i + 1;
+    }
+    if (i == -2)
+        return twoway(cn, haystack+pos+budget, hlen-pos-budget, &n);
+    return n;
+}
+
+compiled_needle* compile_needle(str needle) {
+    PROFILE_SCOPE(PROFILE_LEN(needle));
+    if (needle == NULL) {
+        handle_err(NullPtrError, "NULL pointer was trying to be compiled\n");
+    }
+    size_t len = strlen(needle);
+    compiled_needle* cn = malloc(sizeof(compiled_needle) + len + 1);
+    if (cn == NULL) {
+        handle_err(NullPtrError, "Memory %lu bytes couldn't be alloc'd\n", (ulint)(sizeof(compiled_needle) + len + 1));
+        return NULL;
+    }
+    str copy = (str)(cn + 1);
+    memcpy(copy, needle, len + 1);
+    needle_init(cn, copy, len, NEEDLE_FORWARD | NEEDLE_REVERSE);
+    return cn;
+}
+ll find_compiled(strview haystack, const compiled_needle* needle) {
+    PROFILE_SCOPE(haystack.len);
+    return needle_find(needle, haystack.ptr, haystack.len);
+}
+ll rfind_compiled(strview haystack, const compiled_needle* needle) {
+    PROFILE_SCOPE(haystack.len);
+    return needle_rfind(needle, haystack.ptr, haystack.len);
+}
+ll count_compiled(strview haystack, const compiled_needle* needle) {
+    PROFILE_SCOPE(haystack.len);
+    return needle_count(needle, haystack.ptr, haystack.len);
+}
+void free_needle(compiled_needle* needle) {
+    free(needle);
+}
+
+#ifdef PARALLEL_POOL
+void pool_work(parallel_job* job) {
+    size_t i, finished = 0;
+    while ((i = __atomic_fetch_add(&job->next, 1, __ATOMIC_RELAXED)) < job->chunks) {
+        job->run(job->ctx, i);
+        finished++;
+    }
+    __atomic_add_fetch(&job->done, finished, __ATOMIC_ACQ_REL);
+}
+
+void* pool_worker(void* _) {
+    (void)_;
+    unsigned long long seen = 0;
+    pthread_mutex_lock(&POOL.lock);
+    for (;;) {
+        while (!POOL.stop && POOL.generation == seen)
+            pthread_cond_wait(&POOL.wake, &POOL.lock);
+        if (POOL.stop)
+            break;
+        seen = POOL.generation;
+        parallel_job* job = POOL.job;
+        if (job == NULL)
+            continue;
+        // The submitter waits for active to drop to 0 before its job goes out of scope
+        POOL.active++;
+        pthread_mutex_unlock(&POOL.lock);
+        pool_work(job);
+        pthread_mutex_lock(&POOL.lock);
+        POOL.active--;
+        pthread_cond_broadcast(&POOL.finished);
+    }
+    pthread_mutex_unlock(&POOL.lock);
+    return NULL;
+}
+
+// Joins the workers, the caller holds POOL.submit so no job is running
+void pool_stop(void) {
+    int count = __atomic_load_n(&POOL.count, __ATOMIC_RELAXED);
+    if (count == 0)
+        return;
+    __atomic_store_n(&POOL.count, 0, __ATOMIC_RELEASE);
+    pthread_mutex_lock(&POOL.lock);
+    POOL.stop = 1;
+    pthread_cond_broadcast(&POOL.wake);
+    pthread_mutex_unlock(&POOL.lock);
+    for (int i = 0; i < count; i++)
+        pthread_join(POOL.threads[i], NULL);
+    free(POOL.threads);
+    POOL.threads = NULL;
+    POOL.stop = 0;
+}
+
+void pool_shutdown(void) {
+    pthread_mutex_lock(&POOL.submit);
+    pool_stop();
+    pthread_mutex_unlock(&POOL.submit);
+}
+#endif
+
+// Number of chunks a buffer of len bytes gets split in, 1 means it's not worth going parallel
+size_t parallel_chunks(size_t len) {
+#ifdef PARALLEL_POOL
+    int count = __atomic_load_n(&POOL.count, __ATOMIC_ACQUIRE);
+    size_t min = __atomic_load_n(&PARALLEL_MIN, __ATOMIC_RELAXED);
+    if (count == 0 || len < 2*min)
+        return 1;
+    size_t chunks = len / min, most = (size_t)(count + 1) * 4;
+    return chunks < most ? chunks : most;
+#else
+    (void)len;
+    return 1;
+#endif
+}
+
+void parallel_run(void (*run)(parallel_ctx* ctx, size_t chunk), parallel_ctx* ctx, size_t chunks) {
+#ifdef PARALLEL_POOL
+    // Another thread already owns the pool, the work gets done on the calling thread instead
+    if (chunks > 1 && __atomic_load_n(&POOL.count, __ATOMIC_ACQUIRE) > 0 && pthread_mutex_trylock(&POOL.submit) == 0) {
+        parallel_job job = { run, ctx, chunks, 0, 0 };
+        pthread_mutex_lock(&POOL.lock);
+        POOL.job = &job;
+        POOL.generation++;
+        pthread_cond_broadcast(&POOL.wake);
+        pthread_mutex_unlock(&POOL.lock);
+        pool_work(&job);
+        pthread_mutex_lock(&POOL.lock);
+        while (__atomic_load_n(&job.done, __ATOMIC_ACQUIRE) < chunks || POOL.active > 0)
+            pthread_cond_wait(&POOL.finished, &POOL.lock);
+        POOL.job = NULL;
+        pthread_mutex_unlock(&POOL.lock);
+        pthread_mutex_unlock(&POOL.submit);
+        return;
+    }
+#endif
+    for (size_t i = 0; i < chunks; i++)
+        run(ctx, i);
+}
+
+void parallel_setup(parallel_ctx* ctx, const char* src, str dst, size_t len, size_t chunks) {
+    ctx->src = src;
+    ctx->dst = dst;
+    ctx->len = len;
+    ctx->chunk = (len + chunks - 1) / chunks;
+}
+
+void parallel_transform(void (*run)(parallel_ctx* ctx, size_t chunk), const char* src, str dst, size_t len, char c, char rep, size_t chunks) {
+    parallel_ctx ctx;
+    parallel_setup(&ctx, src, dst, len, chunks);
+    ctx.c = c;
+    ctx.rep = rep;
+    parallel_run(run, &ctx, chunks);
+}
+
+#define CHUNK_LO(ctx, i) ((i) * (ctx)->chunk)
+#define CHUNK_HI(ctx, i) ((i) * (ctx)->chunk + (ctx)->chunk < (ctx)->len ? (i) * (ctx)->chunk + (ctx)->chunk : (ctx)->len)
+
+void chunk_countc(parallel_ctx* ctx, size_t i) {
+    ctx->counts[i] = KERNEL(countc)(ctx->src + CHUNK_LO(ctx, i), CHUNK_HI(ctx, i) - CHUNK_LO(ctx, i), ctx->c);
+}
+
+void chunk_count(parallel_ctx* ctx, size_t i) {
+    // Occurrences starting in this chunk, they can end in the next one
+    size_t lo = CHUNK_LO(ctx, i), hi = CHUNK_HI(ctx, i) + ctx->cn->len - 1;
+    ctx->counts[i] = needle_count(ctx->cn, ctx->src + lo, (hi < ctx->len ? hi : ctx->len) - lo);
+}
+
+void chunk_replacec(parallel_ctx* ctx, size_t i) {
+    size_t lo = CHUNK_LO(ctx, i), hi = CHUNK_HI(ctx, i);
+    memcpy(ctx->dst + lo, ctx->src + lo, hi - lo);
+    KERNEL(replacec)(ctx->dst + lo, hi - lo, ctx->c, ctx->rep);
+}
+
+void chunk_toupper(parallel_ctx* ctx, size_t i) {
+    size_t lo = CHUNK_LO(ctx, i), hi = CHUNK_HI(ctx, i);
+    KERNEL(casemap)(ctx->dst + lo, ctx->src + lo, hi - lo, 'a', 'z');
+}
+
+void chunk_tolower(parallel_ctx* ctx, size_t i) {
+    size_t lo = CHUNK_LO(ctx, i), hi = CHUNK_HI(ctx, i);
+    KERNEL(casemap)(ctx->dst + lo, ctx->src + lo, hi - lo, 'A', 'Z');
+}
+
+// Finds the non overlapping matches starting in chunk i when scanning from starts[i], ends[i] is where the scan stopped
+void chunk_replace_scan(parallel_ctx* ctx, size_t i) {
+    size_t pos = ctx->starts[i], hi = CHUNK_HI(ctx, i) + ctx->cn->len - 1;
+    if (hi > ctx->len)
+        hi = ctx->len;
+    ll n = 0, at;
+    while (pos < hi && (at = needle_find(ctx->cn, ctx->src + pos, hi - pos)) != -1) {
+        pos += at + ctx->cn->len;
+        n++;
+    }
+    ctx->counts[i] = n;
+    ctx->ends[i] = pos > CHUNK_HI(ctx, i) ? pos : CHUNK_HI(ctx, i);
+}
+
+void chunk_replace_write(parallel_ctx* ctx, size_t i) {
+    size_t pos = ctx->starts[i], k = ctx->out[i], hi = CHUNK_HI(ctx, i) + ctx->cn->len - 1;
+    if (hi > ctx->len)
+        hi = ctx->len;
+    for (ll m = 0; m < ctx->counts[i]; m++) {
+        size_t at = pos + needle_find(ctx->cn, ctx->src + pos, hi - pos);
+        memcpy(ctx->dst + k, ctx->src + pos, at - pos);
+        k += at - pos;
+        memcpy(ctx->dst + k, ctx->with.ptr, ctx->with.len);
+        k += ctx->with.len;
+        pos = at + ctx->cn->len;
+    }
+    memcpy(ctx->dst + k, ctx->src + pos, ctx->ends[i] - pos);
+}
+
+ll parallel_countc(const char* ptr, size_t len, char c, size_t chunks) {
+    parallel_ctx ctx;
+    ll counts[chunks], n = 0;
+    parallel_setup(&ctx, ptr, NULL, len, chunks);
+    ctx.c = c;
+    ctx.counts = counts;
+    parallel_run(chunk_countc, &ctx, chunks);
+    for (size_t i = 0; i < chunks; i++)
+        n += counts[i];
+    return n;
+}
+
+ll parallel_count(const compiled_needle* cn, const char* ptr, size_t len, size_t chunks) {
+    parallel_ctx ctx;
+    ll counts[chunks], n = 0;
+    parallel_setup(&ctx, ptr, NULL, len, chunks);
+    ctx.cn = cn;
+    ctx.counts = counts;
+    parallel_run(chunk_count, &ctx, chunks);
+    for (size_t i = 0; i < chunks; i++)
+        n += counts[i];
+    return n;
+}
+
+str parallel_replace(strview orig, strview needle, strview rep, size_t chunks) {
+    parallel_ctx ctx;
+    compiled_needle cn;
+    ll counts[chunks];
+    size_t starts[chunks], ends[chunks], out[chunks];
+    needle_init(&cn, needle.ptr, needle.len, NEEDLE_FORWARD);
+    parallel_setup(&ctx, orig.ptr, NULL, orig.len, chunks);
+    ctx.cn = &cn;
+    ctx.with = rep;
+    ctx.counts = counts;
+    ctx.starts = starts;
+    ctx.ends = ends;
+    ctx.out = out;
+    for (size_t i = 0; i < chunks; i++)
+        starts[i] = CHUNK_LO(&ctx, i);
+    parallel_run(chunk_replace_scan, &ctx, chunks);
+    // A match running past the end of its chunk moves where the next chunk has to start scanning, which can change its matches
+    size_t total = 0;
+    for (size_t i = 0; i < chunks; i++) {
+        if (i > 0 && ends[i-1] > starts[i]) {
+            starts[i] = ends[i-1];
+            chunk_replace_scan(&ctx, i);
+        }
+        out[i] = starts[i] + total*rep.len - total*needle.len;
+        total += counts[i];
+    }
+    size_t len = orig.len + total*rep.len - total*needle.len;
+    ctx.dst = alloc_safe_str(len);
+    parallel_run(chunk_replace_write, &ctx, chunks);
+    ctx.dst[len] = '\0';
+    return ctx.dst;
+}
+
+int ac_child(const multi_pattern* mp, int state, unsigned char c) {
+    for (int i = mp->first[state]; i < mp->first[state+1]; i++)
+        if (mp->bytes[i] == c)
+            return mp->next[i];
+    return -1;
+}
+
+int ac_step(const multi_pattern* mp, int state, unsigned char c) {
+    if (mp->delta != NULL)
+        return mp->delta[(size_t)state * mp->classes + mp->cls[c]];
+    while (state != 0) {
+        int next = ac_child(mp, state, c);
+        if (next != -1)
+            return next;
+        state = mp->fail[state];
+    }
+    return mp->root[c];
+}
+
+int build_child(int* head, const unsigned char* ebyte, const int* eto, const int* enext, int state, unsigned char c) {
+    for (int e = head[state]; e != -1; e = enext[e])
+        if (ebyte[e] == c)
+            return eto[e];
+    return -1;
+}
+
+multi_pattern* compile_patterns(str* patterns, int n) {
+    PROFILE_SCOPE(0);
+    if (patterns == NULL) {
+        handle_err(NullPtrError, "NULL pointer was trying to be compiled\n");
+    }
+    size_t total = 0;
+    for (int i = 0; i < n; i++)
+        total += strlen(patterns[i]);
+    multi_pattern* mp = (multi_pattern*)safe_alloc_generic(sizeof(multi_pattern), 1);
+    mp->patterns = n;
+    mp->lens = (size_t*)safe_alloc_generic(sizeof(size_t), n + 1);
+    mp->out = (int*)safe_alloc_generic(sizeof(int), total + 1);
+    mp->fail = (int*)safe_alloc_generic(sizeof(int), total + 1);
+    mp->dict = (int*)safe_alloc_generic(sizeof(int), total + 1);
+    int* head = (int*)safe_alloc_generic(sizeof(int), total + 1);
+    unsigned char* ebyte = (unsigned char*)safe_alloc_generic(1, total + 1);
+    int* eto = (int*)safe_alloc_generic(sizeof(int), total + 1);
+    int* enext = (int*)safe_alloc_generic(sizeof(int), total + 1);
+    int states = 1, edges = 0;
+    head[0] = -1;
+    mp->out[0] = -1;
+    // Trie of all the patterns, empty ones can never match
+    for (int i = 0; i < n; i++) {
+        const unsigned char* pat = (const unsigned char*)patterns[i];
+        int state = 0;
+        mp->lens[i] = strlen(patterns[i]);
+        for (size_t j = 0; j < mp->lens[i]; j++) {
+            int next = build_child(head, ebyte, eto, enext, state, pat[j]);
+            if (next == -1) {
+                next = states++;
+                head[next] = -1;
+                mp->out[next] = -1;
+                ebyte[edges] = pat[j];
+                eto[edges] = next;
+                enext[edges] = head[state];
+                head[state] = edges++;
+            }
+            state = next;
+        }
+        if (state != 0 && mp->out[state] == -1)
+            mp->out[state] = i;
+    }
+    mp->states = states;
+    // Flatten the edges, root gets a full table since every search keeps going back to it
+    mp->first = (int*)safe_alloc_generic(sizeof(int), states + 1);
+    mp->bytes = (unsigned char*)safe_alloc_generic(1, edges + 1);
+    mp->next = (int*)safe_alloc_generic(sizeof(int), edges + 1);
+    for (int s = 0, k = 0; s < states; s++) {
+        mp->first[s] = k;
+        for (int e = head[s]; e != -1; e = enext[e]) {
+            mp->bytes[k] = ebyte[e];
+            mp->next[k++] = eto[e];
+        }
+        mp->first[s+1] = k;
+    }
+    for (int c = 0; c < 256; c++) {
+        int next = ac_child(mp, 0, (unsigned char)c);
+        mp->root[c] = next == -1 ? 0 : next;
+    }
+    // Failure and dictionary links, in breadth first order
+    int* queue = head;
+    int qhead = 0, qtail = 0;
+    mp->fail[0] = 0;
+    mp->dict[0] = 0;
+    for (int i = mp->first[0]; i < mp->first[1]; i++) {
+        mp->fail[mp->next[i]] = 0;
+        mp->dict[mp->next[i]] = 0;
+        queue[qtail++] = mp->next[i];
+    }
+    while (qhead < qtail) {
+        int state = queue[qhead++];
+        for (int i = mp->first[state]; i < mp->first[state+1]; i++) {
+            int child = mp->next[i];
+            int fail = ac_step(mp, mp->fail[state], mp->bytes[i]);
+            mp->fail[child] = fail;
+            mp->dict[child] = mp->out[fail] != -1 ? fail : mp->dict[fail];
+            queue[qtail++] = child;
+        }
+    }
+    // Full transition table over the classes of bytes that appear in patterns, as long as it stays reasonably small
+    int used[256] = { 0 };
+    for (int i = 0; i < edges; i++)
+        used[mp->bytes[i]] = 1;
+    mp->classes = 1;
+    for (int c = 0; c < 256; c++)
+        mp->cls[c] = used[c] ? mp->classes++ : 0;
+    if ((size_t)states * mp->classes <= MAX_DFA_ENTRIES) {
+        int* delta = (int*)safe_alloc_generic(sizeof(int), (size_t)states * mp->classes);
+        for (int i = 0; i < qtail + 1; i++) {
+            int state = i == 0 ? 0 : queue[i-1];
+            for (int c = 0; c < 256; c++) {
+                if (!used[c])
+                    continue;
+                int next = state == 0 ? mp->root[c] : ac_child(mp, state, (unsigned char)c);
+                if (next == -1)
+                    next = delta[(size_t)mp->fail[state] * mp->classes + mp->cls[c]];
+                delta[(size_t)state * mp->classes + mp->cls[c]] = next;
+            }
+        }
+        mp->delta = delta;
+    }
+    free(head);
+    free(ebyte);
+    free(eto);
+    free(enext);
+    return mp;
+}
+
+ll find_any(strview haystack, const multi_pattern* patterns, int* which) {
+    PROFILE_SCOPE(haystack.len);
+    int state = 0;
+    for (size_t i = 0; i < haystack.len; i++) {
+        state = ac_step(patterns, state, (unsigned char)haystack.ptr[i]);
+        int hit = patterns->out[state] != -1 ? state : patterns->dict[state];
+        if (hit != 0) {
+            int pattern = patterns->out[hit];
+            if (which != NULL)
+                p(which) = pattern;
+            return i + 1 - patterns->lens[pattern];
+        }
+    }
+    return -1;
+}
+
+void count_each(strview haystack, const multi_pattern* patterns, ll* counts) {
+    PROFILE_SCOPE(haystack.len);
+    int state = 0;
+    memset(counts, 0, sizeof(ll) * patterns->patterns);
+    for (size_t i = 0; i < haystack.len; i++) {
+        state = ac_step(patterns, state, (unsigned char)haystack.ptr[i]);
+        for (int hit = patterns->out[state] != -1 ? state : patterns->dict[state]; hit != 0; hit = patterns->dict[hit])
+            counts[patterns->out[hit]]++;
+    }
+}
+
+str replace_many(str orig, const multi_pattern* patterns, str* reps) {
+    PROFILE_SCOPE(PROFILE_LEN(orig));
+    if (orig == NULL || reps == NULL) {
+        handle_err(NullPtrError, "NULL pointer was trying to be replaced\n");
+    }
+    strview view = sv_from(orig);
+    size_t cap = 64, found = 0, len = view.len, cut = 0;
+    size_t* starts = (size_t*)safe_alloc_generic(sizeof(size_t), cap);
+    int* which = (int*)safe_alloc_generic(sizeof(int), cap);
+    size_t* replens = (size_t*)safe_alloc_generic(sizeof(size_t), patterns->patterns + 1);
+    if (starts == NULL || which == NULL || replens == NULL) {
+        free(starts);
+        free(which);
+        free(replens);
+        return NULL;
+    }
+    for (int i = 0; i < patterns->patterns; i++)
+        replens[i] = strlen(reps[i]);
+    int state = 0;
+    for (size_t i = 0; i < view.len; i++) {
+        state = ac_step(patterns, state, (unsigned char)view.ptr[i]);
+        // Longest match ending here that doesn't overlap the previous replacement
+        for (int hit = patterns->out[state] != -1 ? state : patterns->dict[state]; hit != 0; hit = patterns->dict[hit]) {
+            int pattern = patterns->out[hit];
+            size_t start = i + 1 - patterns->lens[pattern];
+            if (start < cut)
+                continue;
+            if (found == cap) {
+                size_t* grown_starts = realloc(starts, sizeof(size_t) * cap * 2);
+                if (grown_starts != NULL)
+                    starts = grown_starts;
+                int* grown_which = grown_starts != NULL ? realloc(which, sizeof(int) * cap * 2) : NULL;
+                if (grown_which == NULL) {
+                    handle_err(NullPtrError, "Memory %lu bytes couldn't be alloc'd\n", (ulint)((sizeof(size_t) + sizeof(int)) * cap * 2));
+                    free(starts);
+                    free(which);
+                    free(replens);
+                    return NULL;
+                }
+                which = grown_which;
+                cap *= 2;
+            }
+            starts[found] = start;
+            which[found++] = pattern;
+            len += replens[pattern] - patterns->lens[pattern];
+            cut = i + 1;
+            break;
+        }
+    }
+    str ptr = alloc_safe_str(len);
+    size_t j = 0, k = 0;
+    for (size_t i = 0; i < found; i++) {
+        memcpy(ptr+k, view.ptr+j, starts[i]-j);
+        k += starts[i]-j;
+        memcpy(ptr+k, reps[which[i]], replens[which[i]]);
+        k += replens[which[i]];
+        j = starts[i] + patterns->lens[which[i]];
+    }
+    memcpy(ptr+k, view.ptr+j, view.len-j);
+    ptr[len] = '\0';
+    free(starts);
+    free(which);
+    free(replens);
+    return ptr;
+}
+
+void free_patterns(multi_pattern* patterns) {
+    if (patterns == NULL)
+        return;
+    free(patterns->lens);
+    free(patterns->out);
+    free(patterns->fail);
+    free(patterns->dict);
+    free(patterns->first);
+    free(patterns->bytes);
+    free(patterns->next);
+    free(patterns->delta);
+    free(patterns);
+}
+
+// Adds the other case of every letter in set
+void glob_fold(charset* set) {
+    for (unsigned int c = 'a'; c <= 'z'; c++)
+        if (CS_HAS(set, c) || CS_HAS(set, c - 32)) {
+            set->bits[c >> 3] |= 1 << (c & 7);
+            set->bits[(c - 32) >> 3] |= 1 << ((c - 32) & 7);
+        }
+}
+
+// Reads the item at p into set (the bytes it matches) and returns how many bytes of the pattern it takes up, 0 if it's
+// malformed. A run of '*' sets star instead: 2 if it can cross '/' (always, unless GlobPathname is set and the run is a single '*'), else 1.
+size_t glob_item(const unsigned char* p, int flags, charset* set, int* star) {
+    size_t i = 1;
+    *star = 0;
+    unsigned char* bits = set->bits;
+    memset(bits, 0, sizeof(set->bits));
+    if (p[0] == '*') {
+        while (p[i] == '*')
+            i++;
+        *star = i > 1 || !(flags & GlobPathname) ? 2 : 1;
+        return i;
+    }
+    if (p[0] == '?') {
+        memset(bits, 0xFF, sizeof(set->bits));
+    } else if (p[0] == '[') {
+        int negate = p[1] == '!' || p[1] == '^';
+        i += negate;
+        for (int first = 1; p[i] != ']' || first; first = 0) {
+            unsigned int lo = p[i], hi;
+            if (lo == '\0' || (lo == '\\' && p[i + 1] == '\0'))
+                return 0;
+            if (lo == '\\')
+                lo = p[++i];
+            hi = lo;
+            i++;
+            if (p[i] == '-' && p[i + 1] != ']' && p[i + 1] != '\0') {
+                i++;
+                if (p[i] == '\\' && p[i + 1] == '\0')
+                    return 0;
+                if (p[i] == '\\')
+                    i++;
+                hi = p[i++];
+            }
+            for (unsigned int c = lo; c <= hi; c++)
+                bits[c >> 3] |= 1 << (c & 7);
+        }
+        i++;
+        if (flags & GlobCaseless)
+            glob_fold(set);
+        if (negate)
+            for (size_t k = 0; k < sizeof(set->bits); k++)
+                bits[k] = ~bits[k];
+    } else {
+        if (p[0] == '\\' && p[1] == '\0')
+            return 0;
+        i += p[0] == '\\';
+        bits[p[i - 1] >> 3] |= 1 << (p[i - 1] & 7);
+        if (flags & GlobCaseless)
+            glob_fold(set);
+    }
+    if ((flags & GlobPathname) && p[0] != '\\' && p[0] != '/')
+        bits['/' >> 3] &= ~(1 << ('/' & 7));
+    return i;
+}
+
+glob_pattern* compile_glob(const char* pattern, int flags) {
+    PROFILE_SCOPE(PROFILE_LEN(pattern));
+    if (pattern == NULL) {
+        handle_err(NullPtrError, "NULL pointer was trying to be compiled\n");
+        return NULL;
+    }
+    const unsigned char* pat = (const unsigned char*)pattern;
+    charset set;
+    size_t atoms = 0, head = 0, tail = 0;
+    int star, stars = 0;
+    for (size_t i = 0, used; pat[i] != '\0'; i += used) {
+        used = glob_item(pat + i, flags, &set, &star);
+        if (used == 0) {
+            handle_err(InvalidPattern, "Malformed glob pattern %s, the item at index %lu never ends\n", pattern, (ulint)i);
+            return NULL;
+        }
+        if (star) {
+            stars = 1;
+            tail = 0;
+            continue;
+        }
+        atoms++;
+        head += !stars;
+        tail++;
+    }
+    if (!stars)
+        tail = 0;
+    if (atoms >= GLOB_MAX_WORDS * 64) {
+        handle_err(InvalidPattern, "Glob pattern %s has %lu items, the maximum is %d\n", pattern, (ulint)atoms, GLOB_MAX_WORDS * 64 - 1);
+        return NULL;
+    }
+    size_t words = atoms / 64 + 1;
+    glob_pattern* glob = (glob_pattern*)safe_alloc_generic(sizeof(glob_pattern) + 2 * 256 * words * sizeof(unsigned long long), 1);
+    glob->atoms = atoms;
+    glob->words = words;
+    glob->head = head;
+    glob->tail = tail;
+    glob->stars = stars;
+    glob->masks = (unsigned long long*)(glob + 1);
+    glob->loops = glob->masks + 256 * words;
+    // Second pass: item s sets bit s + 1 for the bytes it matches, a '*' before it keeps bit s for the ones it matches
+    size_t s = 0;
+    for (size_t i = 0; pat[i] != '\0'; s += !star) {
+        i += glob_item(pat + i, flags, &set, &star);
+        for (unsigned int c = 0; c < 256; c++) {
+            if (star)
+                glob->loops[c * words + (s >> 6)] |= (unsigned long long)(star == 2 || c != '/') << (s & 63);
+            else
+                glob->masks[c * words + ((s + 1) >> 6)] |= (unsigned long long)CS_HAS(&set, c) << ((s + 1) & 63);
+        }
+    }
+    glob->open = stars && head + tail == atoms;
+    for (unsigned int c = 0; c < 256 && glob->open; c++)
+        glob->open = GLOB_HAS(glob->loops + c * words, head);
+    return glob;
+}
+
+// Bytes before the first '*' and after the last one are checked on their own, the automaton only runs over the rest
+int glob_run(const glob_pattern* glob, const unsigned char* text, size_t len) {
+    const size_t w = glob->words;
+    const unsigned long long* masks = glob->masks;
+    const unsigned long long* loops = glob->loops;
+    if (len < glob->atoms || (!glob->stars && len != glob->atoms))
+        return 0;
+    // The tail goes first, paths that share a prefix usually differ towards the end
+    for (size_t i = 1; i <= glob->tail; i++)
+        if (!GLOB_HAS(masks + text[len - i] * w, glob->atoms - i + 1))
+            return 0;
+    for (size_t i = 0; i < glob->head; i++)
+        if (!GLOB_HAS(masks + text[i] * w, i + 1))
+            return 0;
+    if (!glob->stars || glob->open)
+        return 1;
+    const size_t accept = glob->atoms - glob->tail;
+    const unsigned char* end = text + len - glob->tail;
+    text += glob->head;
+    if (w == 1) {
+        unsigned long long d = 1ULL << glob->head;
+        for (; text < end && d != 0; text++)
+            d = ((d << 1) & masks[*text]) | (d & loops[*text]);
+        return (d >> accept) & 1;
+    }
+    unsigned long long d[GLOB_MAX_WORDS];
+    memset(d, 0, w * sizeof(unsigned long long));
+    d[glob->head >> 6] = 1ULL << (glob->head & 63);
+    for (unsigned long long any = 1; text < end && any != 0; text++) {
+        const unsigned long long* m = masks + *text * w;
+        const unsigned long long* l = loops + *text * w;
+        unsigned long long carry = 0;
+        any = 0;
+        for (size_t k = 0; k < w; k++) {
+            unsigned long long x = d[k];
+            d[k] = (((x << 1) | carry) & m[k]) | (x & l[k]);
+            carry = x >> 63;
+            any |= d[k];
+        }
+    }
+    return GLOB_HAS(d, accept);
+}
+
+int match_glob(strview text, const glob_pattern* glob) {
+    PROFILE_SCOPE(text.len);
+    if (glob == NULL || (text.ptr == NULL && text.len > 0)) {
+        handle_err(NullPtrError, "NULL pointer was passed to match_glob\n");
+        return 0;
+    }
+    return glob_run(glob, (const unsigned char*)text.ptr, text.len);
+}
+
+int match_many(char** strings, int n, const glob_pattern* glob, int* results) {
+    PROFILE_SCOPE(0);
+    if (strings == NULL || glob == NULL) {
+        handle_err(NullPtrError, "NULL pointer was passed to match_many\n");
+        return 0;
+    }
+    int matched = 0;
+    for (int i = 0; i < n; i++) {
+        int found = strings[i] != NULL && glob_run(glob, (const unsigned char*)strings[i], strlen(strings[i]));
+        if (results != NULL)
+            results[i] = found;
+        matched += found;
+    }
+    return matched;
+}
+
+void free_glob(glob_pattern* glob) {
+    free(glob);
+}
+
+unsigned long long POW10_MANTISSA[POW10_MAX - POW10_MIN + 1][2];  // {low, high} 64 bits of the mantissa of every 10^e
+int POW10_READY = 0;
+
+// Eight ASCII digits at once, the first one ends up in the lowest byte
+unsigned long long load_8digits(const unsigned char* p) {
+    unsigned long long x;
+    memcpy(&x, p, 8);
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    x = __builtin_bswap64(x);
+#endif
+    return x;
+}
+
+int is_8digits(unsigned long long x) {
+    return ((x & 0xF0F0F0F0F0F0F0F0ULL) | (((x + 0x0606060606060606ULL) & 0xF0F0F0F0F0F0F0F0ULL) >> 4)) == 0x3333333333333333ULL;
+}
+
+// Pairs of digits get merged into bytes, then pairs of bytes into 16 bit halves and those into the result
+unsigned int parse_8digits(unsigned long long x) {
+    x -= 0x3030303030303030ULL;
+    x = x * 10 + (x >> 8);
+    x = ((x & 0x000000FF000000FFULL) * (100 + (1000000ULL << 32)) + ((x >> 16) & 0x000000FF000000FFULL) * (1 + (10000ULL << 32))) >> 32;
+    return (unsigned int)x;
+}
+
+int is_blank(unsigned char c) {
+    return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+}
+
+void trim_number(const unsigned char** p, size_t* len) {
+    while (*len > 0 && is_blank(**p)) {
+        (*p)++;
+        (*len)--;
+    }
+    while (*len > 0 && is_blank((*p)[*len - 1]))
+        (*len)--;
+}
+
+int parse_ll_n(const unsigned char* p, size_t len, long long* out) {
+    unsigned long long v = 0;
+    int neg = 0;
+    trim_number(&p, &len);
+    if (len > 0 && (*p == '-' || *p == '+')) {
+        neg = *p == '-';
+        p++;
+        len--;
+    }
+    if (len == 0)
+        return 0;
+    while (len > 1 && *p == '0') {
+        p++;
+        len--;
+    }
+    if (len > 19)
+        return 0;
+    for (; len >= 8; p += 8, len -= 8) {
+        unsigned long long x = load_8digits(p);
+        if (!is_8digits(x))
+            return 0;
+        v = v * 100000000 + parse_8digits(x);
+    }
+    // Padding the last few digits into a word would make the load wait for the bytes stored into it
+    for (; len > 0; p++, len--) {
+        unsigned int c = *p - '0';
+        if (c > 9)
+            return 0;
+        v = v * 10 + c;
+    }
+    if (v > (unsigned long long)LLONG_MAX + neg)
+        return 0;
+    *out = neg ? -(ll)(v - 1) - 1 : (ll)v;
+    return 1;
+}
+
+// Keeps the top 128 bits of a number made of POW10_LIMBS 32 bit limbs, shifted so that its top bit is the top bit of m
+void top_128(const unsigned int* big, unsigned long long m[2]) {
+    int top = POW10_LIMBS - 1;
+    while (big[top] == 0)
+        top--;
+    int msb = top * 32 + 31 - __builtin_clz(big[top]);
+    m[0] = m[1] = 0;
+    for (int k = 0; k < 128; k++) {
+        int b = msb - 127 + k;
+        if (b >= 0 && ((big[b >> 5] >> (b & 31)) & 1))
+            m[k >> 6] |= 1ULL << (k & 63);
+    }
+}
+
+// 10^e and 5^e have the same mantissa: 5^e is computed exactly for e >= 0, for e < 0 it's 2^1151 / 5^-e rounded down
+// (rounding down at every division by 5 is the same as rounding down once), in both cases only the top 128 bits are kept.
+void fill_pow10(void) {
+    unsigned int big[POW10_LIMBS];
+    memset(big, 0, sizeof(big));
+    big[0] = 1;
+    for (int e = 0; e <= POW10_MAX; e++) {
+        unsigned long long carry = 0;
+        for (int i = 0; i < POW10_LIMBS && e > 0; i++) {
+            carry += (unsigned long long)big[i] * 5;
+            big[i] = (unsigned int)carry;
+            carry >>= 32;
+        }
+        top_128(big, POW10_MANTISSA[e - POW10_MIN]);
+    }
+    memset(big, 0, sizeof(big));
+    big[POW10_LIMBS - 1] = 1U << 31;
+    for (int e = -1; e >= POW10_MIN; e--) {
+        unsigned long long rem = 0;
+        for (int i = POW10_LIMBS - 1; i >= 0; i--) {
+            rem = (rem << 32) | big[i];
+            big[i] = (unsigned int)(rem / 5);
+            rem %= 5;
+        }
+        top_128(big, POW10_MANTISSA[e - POW10_MIN]);
+    }
+    POW10_READY = 1;
+}
+
+unsigned long long mul_64x64(unsigned long long a, unsigned long long b, unsigned long long* lo) {
+#ifdef __SIZEOF_INT128__
+    unsigned __int128 r = (unsigned __int128)a * b;
+    *lo = (unsigned long long)r;
+    return (unsigned long long)(r >> 64);
+#else
+    unsigned long long a0 = a & 0xFFFFFFFF, a1 = a >> 32, b0 = b & 0xFFFFFFFF, b1 = b >> 32;
+    unsigned long long p01 = a0 * b1, p10 = a1 * b0;
+    unsigned long long mid = ((a0 * b0) >> 32) + (p01 & 0xFFFFFFFF) + (p10 & 0xFFFFFFFF);
+    *lo = (mid << 32) | ((a0 * b0) & 0xFFFFFFFF);
+    return a1 * b1 + (p01 >> 32) + (p10 >> 32) + (mid >> 32);
+#endif
+}
+
+// Eisel-Lemire: w * 10^e is w times the 128 bit mantissa of 10^e, rounded to 53 bits. Returns 0 when the truncated
+// product is too close to a rounding boundary to tell (or the result isn't a normal double), then another method has to decide.
+int eisel_lemire(unsigned long long w, int e, double* out) {
+    const unsigned long long* pow = POW10_MANTISSA[e - POW10_MIN];
+    int clz = __builtin_clzll(w);
+    w <<= clz;
+    long long log2 = e >= 0 ? (217706LL * e) >> 16 : -((-217706LL * e + 65535) >> 16);
+    unsigned long long exp2 = (unsigned long long)(log2 + 64 + 1023 - clz);
+    unsigned long long lo, hi = mul_64x64(w, pow[1], &lo);
+    // The low 9 bits of hi get shifted out, unless they're all ones the rest of the mantissa can't change the result
+    if ((hi & 0x1FF) == 0x1FF && lo + w < w) {
+        unsigned long long lo2, hi2 = mul_64x64(w, pow[0], &lo2);
+        unsigned long long merged = lo + hi2;
+        hi += merged < lo;
+        if ((hi & 0x1FF) == 0x1FF && merged + 1 == 0 && lo2 + w < w)
+            return 0;
+        lo = merged;
+    }
+    unsigned long long msb = hi >> 63;
+    unsigned long long mantissa = hi >> (msb + 9);
+    exp2 -= 1 ^ msb;
+    if (lo == 0 && (hi & 0x1FF) == 0 && (mantissa & 3) == 1)
+        return 0;
+    mantissa = (mantissa + (mantissa & 1)) >> 1;
+    if (mantissa >> 53) {
+        mantissa >>= 1;
+        exp2++;
+    }
+    if (exp2 - 1 >= 0x7FF - 1)
+        return 0;
+    unsigned long long bits = exp2 << 52 | (mantissa & 0x000FFFFFFFFFFFFFULL);
+    memcpy(out, &bits, sizeof(bits));
+    return 1;
+}
+
+// Whatever the fast paths can't settle goes through strtod(), with the decimal point swapped for the one of the locale
+double strtod_c(const unsigned char* p, size_t len) {
+    char local[128];
+    const char* point = localeconv()->decimal_point;
+    size_t plen = strlen(point), n = 0;
+    str buf = len * plen < sizeof(local) ? local : (str)safe_alloc_generic(len * plen + 1, 1);
+    for (size_t i = 0; i < len; i++) {
+        if (p[i] == '.') {
+            memcpy(buf + n, point, plen);
+            n += plen;
+        } else {
+            buf[n++] = p[i];
+        }
+    }
+    buf[n] = '\0';
+    double d = strtod(buf, NULL);
+    if (buf != local)
+        free(buf);
+    return d;
+}
+
+typedef struct decimal_parts {
+    unsigned long long w;   // first 19 significant digits
+    int sig;                // digits in w
+    int truncated;          // some nonzero digit didn't fit in w
+    size_t digits;          // digits read, significant or not
+    ll exp;                 // the number is w * 10^exp, plus whatever got truncated
+} decimal_parts;
+
+// Reads the digits from p + i on, 8 at a time while they're all digits and fit in w, and returns where they end
+size_t take_digits(const unsigned char* p, size_t len, size_t i, decimal_parts* d, int fraction) {
+    int chunks = 1;
+    while (i < len) {
+        if (chunks && len - i >= 8 && d->sig <= 11) {
+            unsigned long long x = load_8digits(p + i);
+            if (is_8digits(x)) {
+                d->w = d->w * 100000000 + parse_8digits(x);
+                d->sig += 8;
+                d->digits += 8;
+                d->exp -= fraction * 8;
+                i += 8;
+                continue;
+            }
+            chunks = 0;
+        }
+        unsigned int c = p[i] - '0';
+        if (c > 9)
+            break;
+        if (d->sig < 19) {
+            d->w = d->w * 10 + c;
+            d->sig++;
+            d->exp -= fraction;
+        } else {
+            d->exp += !fraction;
+            d->truncated |= c != 0;
+        }
+        d->digits++;
+        i++;
+    }
+    return i;
+}
+
+double decimal_to_double(const decimal_parts* d, const unsigned char* text, size_t len) {
+    static const double exact[23] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15,
+                                      1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22 };
+    double x, y;
+    if (d->w == 0 || d->exp < POW10_MIN)
+        return 0.0;
+    if (d->exp > POW10_MAX)
+        return INFINITY;
+    // Clinger: both w and 10^|exp| are exact doubles, so a single correctly rounded operation gives the result
+    if (FLT_EVAL_METHOD == 0 && !d->truncated && d->w <= (1ULL << 53) && d->exp >= -22 && d->exp <= 22)
+        return d->exp >= 0 ? (double)d->w * exact[d->exp] : (double)d->w / exact[-d->exp];
+    if (!POW10_READY)
+        fill_pow10();
+    // With truncated digits the number lies between w and w + 1 (times 10^exp), if both round the same that's it
+    if (eisel_lemire(d->w, (int)d->exp, &x) && (!d->truncated || (eisel_lemire(d->w + 1, (int)d->exp, &y) && x == y)))
+        return x;
+    return strtod_c(text, len);
+}
+
+int parse_double_n(const unsigned char* p, size_t len, double* out) {
+    decimal_parts d = { 0, 0, 0, 0, 0 };
+    size_t i = 0;
+    int neg = 0;
+    trim_number(&p, &len);
+    if (len > 0 && (*p == '-' || *p == '+')) {
+        neg = *p == '-';
+        i++;
+    }
+    static const char* special[3] = { "inf", "infinity", "nan" };
+    for (int k = 0; k < 3 && i < len && ((p[i] | 0x20) == 'i' || (p[i] | 0x20) == 'n'); k++) {
+        size_t n = strlen(special[k]);
+        int same = len - i == n;
+        for (size_t j = 0; same && j < n; j++)
+            same = (p[i + j] | 0x20) == special[k][j];
+        if (same) {
+            *out = k < 2 ? (neg ? -INFINITY : INFINITY) : (neg ? -NAN : NAN);
+            return 1;
+        }
+    }
+    while (i < len && p[i] == '0') {
+        d.digits++;
+        i++;
+    }
+    i = take_digits(p, len, i, &d, 0);
+    if (i < len && p[i] == '.') {
+        i++;
+        while (d.sig == 0 && i < len && p[i] == '0') {
+            d.digits++;
+            d.exp--;
+            i++;
+        }
+        i = take_digits(p, len, i, &d, 1);
+    }
+    if (d.digits == 0)
+        return 0;
+    if (i < len && (p[i] | 0x20) == 'e') {
+        ll e = 0;
+        int eneg = 0;
+        i++;
+        if (i < len && (p[i] == '-' || p[i] == '+'))
+            eneg = p[i++] == '-';
+        if (i == len || (unsigned int)(p[i] - '0') > 9)
+            return 0;
+        for (; i < len && (unsigned int)(p[i] - '0') <= 9; i++)
+            if (e < 100000)
+                e = e * 10 + (p[i] - '0');
+        d.exp += eneg ? -e : e;
+    }
+    if (i != len)
+        return 0;
+    double x = decimal_to_double(&d, p + (p[0] == '-' || p[0] == '+'), len - (p[0] == '-' || p[0] == '+'));
+    *out = neg ? -x : x;
+    return 1;
+}
+
+int sv_parse_ll(strview sv, long long* out) {
+    PROFILE_SCOPE(sv.len);
+    if (out == NULL || (sv.ptr == NULL && sv.len > 0)) {
+        handle_err(NullPtrError, "NULL pointer was passed to sv_parse_ll\n");
+        return 0;
+    }
+    return parse_ll_n((const unsigned char*)sv.ptr, sv.len, out);
+}
+
+int sv_parse_double(strview sv, double* out) {
+    PROFILE_SCOPE(sv.len);
+    if (out == NULL || (sv.ptr == NULL && sv.len > 0)) {
+        handle_err(NullPtrError, "NULL pointer was passed to sv_parse_double\n");
+        return 0;
+    }
+    return parse_double_n((const unsigned char*)sv.ptr, sv.len, out);
+}
+
+int parse_column_ll(vstr fields, int n, long long* out, int* valid) {
+    PROFILE_SCOPE(0);
+    if (fields == NULL || out == NULL) {
+        handle_err(NullPtrError, "NULL pointer was passed to parse_column_ll\n");
+        return 0;
+    }
+    int parsed = 0;
+    for (int i = 0; i < n; i++) {
+        int ok = fields[i] != NULL && parse_ll_n((const unsigned char*)fields[i], strlen(fields[i]), out + i);
+        if (!ok)
+            out[i] = 0;
+        if (valid != NULL)
+            valid[i] = ok;
+        parsed += ok;
+    }
+    return parsed;
+}
+
+int parse_column_double(vstr fields, int n, double* out, int* valid) {
+    PROFILE_SCOPE(0);
+    if (fields == NULL || out == NULL) {
+        handle_err(NullPtrError, "NULL pointer was passed to parse_column_double\n");
+        return 0;
+    }
+    int parsed = 0;
+    for (int i = 0; i < n; i++) {
+        int ok = fields[i] != NULL && parse_double_n((const unsigned char*)fields[i], strlen(fields[i]), out + i);
+        if (!ok)
+            out[i] = 0.0;
+        if (valid != NULL)
+            valid[i] = ok;
+        parsed += ok;
+    }
+    return parsed;
+}
+
+int sv_parse_column_ll(const strview* fields, int n, long long* out, int* valid) {
+    PROFILE_SCOPE(0);
+    if (fields == NULL || out == NULL) {
+        handle_err(NullPtrError, "NULL pointer was passed to sv_parse_column_ll\n");
+        return 0;
+    }
+    int parsed = 0;
+    for (int i = 0; i < n; i++) {
+        int ok = (fields[i].ptr != NULL || fields[i].len == 0) && parse_ll_n((const unsigned char*)fields[i].ptr, fields[i].len, out + i);
+        if (!ok)
+            out[i] = 0;
+        if (valid != NULL)
+            valid[i] = ok;
+        parsed += ok;
+    }
+    return parsed;
+}
+
+int sv_parse_column_double(const strview* fields, int n, double* out, int* valid) {
+    PROFILE_SCOPE(0);
+    if (fields == NULL || out == NULL) {
+        handle_err(NullPtrError, "NULL pointer was passed to sv_parse_column_double\n");
+        return 0;
+    }
+    int parsed = 0;
+    for (int i = 0; i < n; i++) {
+        int ok = (fields[i].ptr != NULL || fields[i].len == 0) && parse_double_n((const unsigned char*)fields[i].ptr, fields[i].len, out + i);
+        if (!ok)
+            out[i] = 0.0;
+        if (valid != NULL)
+            valid[i] = ok;
+        parsed += ok;
+    }
+    return parsed;
+}
+
+// x >> n rounded towards minus infinity, shifting a negative number right is implementation defined
+ll floor_shift(ll x, int n) {
+    return x >= 0 ? x >> n : -((-x + (1LL << n) - 1) >> n);
+}
+
+// The top 64 bits of g * cp, g being 128 bits, with the lowest bit set if anything below them was dropped (round to odd)
+unsigned long long round_to_odd(const unsigned long long g[2], unsigned long long cp) {
+    unsigned long long x0, x1 = mul_64x64(g[0], cp, &x0);
+    unsigned long long y0, y1 = mul_64x64(g[1], cp, &y0);
+    unsigned long long z = y0 + x1;
+    y1 += z < y0;
+    return y1 | (z > 1);
+}
+
+// Schubfach: the bounds of the rounding interval of x (finite and > 0) are scaled by 10^-k, k picked so that at most
+// one decimal with fewer digits fits in it. The mantissas in POW10_MANTISSA are rounded down, past 5^55 they aren't exact
+// so adding one rounds them up, which together with round_to_odd keeps every comparison exact.
+// Returns the shortest digits that read back as x (the closest ones on ties), *e10 is the exponent of the last digit.
+unsigned long long shortest_digits(double x, int* e10) {
+    unsigned long long bits, c;
+    memcpy(&bits, &x, sizeof(bits));
+    unsigned long long frac = bits & ((1ULL << 52) - 1);
+    int exp = (int)(bits >> 52);
+    int q;
+    if (exp != 0) {
+        c = frac | (1ULL << 52);
+        q = exp - 1075;
+        // Integers below 2^53 are their own shortest digits
+        if (q <= 0 && q > -53 && (c & ((1ULL << -q) - 1)) == 0) {
+            *e10 = 0;
+            return c >> -q;
+        }
+    } else {
+        c = frac;
+        q = -1074;
+    }
+    int even = (c & 1) == 0, closer = frac == 0 && exp > 1;
+    unsigned long long cbl = 4 * c - 2 + closer, cb = 4 * c, cbr = 4 * c + 2;
+    // floor(log10(2^q)), or floor(log10(3/4 * 2^q)) when the interval below x is half as wide
+    int k = (int)floor_shift(q * 1262611LL - (closer ? 524031 : 0), 22);
+    int h = q + (int)floor_shift(-k * 1741647LL, 19) + 1;
+    if (!POW10_READY)
+        fill_pow10();
+    const unsigned long long* m = POW10_MANTISSA[-k - POW10_MIN];
+    unsigned long long g[2] = { m[0] + 1, m[1] };
+    if (-k >= 0 && -k <= 55)
+        g[0] = m[0];
+    else
+        g[1] += g[0] == 0;
+    unsigned long long vbl = round_to_odd(g, cbl << h), vb = round_to_odd(g, cb << h), vbr = round_to_odd(g, cbr << h);
+    unsigned long long lower = vbl + !even, upper = vbr - !even;
+    unsigned long long s = vb / 4;
+    *e10 = k;
+    if (s >= 10) {
+        unsigned long long sp = s / 10;
+        int up = lower <= 40 * sp, wp = 40 * sp + 40 <= upper;
+        if (up != wp) {
+            *e10 = k + 1;
+            return sp + wp;
+        }
+    }
+    int u = lower <= 4 * s, w = 4 * s + 4 <= upper;
+    if (u != w)
+        return s + w;
+    unsigned long long mid = 4 * s + 2;
+    return s + (vb > mid || (vb == mid && (s & 1)));
+}
+
+// The digits of shortest_digits() without trailing zeros, laid out like JavaScript's Number.toString()
+size_t format_double_n(char out[32], double x) {
+    char buf[20];
+    size_t n = 0, k = 0;
+    int e10 = 0;
+    if (signbit(x)) {
+        out[n++] = '-';
+        x = -x;
+    }
+    if (isnan(x) || isinf(x) || x == 0.0) {
+        const char* word = isnan(x) ? "nan" : x == 0.0 ? "0" : "inf";
+        n = isnan(x) ? 0 : n;
+        memcpy(out + n, word, strlen(word));
+        return n + strlen(word);
+    }
+    unsigned long long w = shortest_digits(x, &e10);
+    while (w % 10 == 0) {
+        w /= 10;
+        e10++;
+    }
+    char* digits = buf + sizeof(buf);
+    while (w > 0) {
+        *--digits = (char)('0' + w % 10);
+        w /= 10;
+        k++;
+    }
+    // From here on e10 is the exponent of the first digit
+    e10 += (int)k - 1;
+    if (e10 >= 21 || e10 <= -7) {
+        out[n++] = digits[0];
+        if (k > 1) {
+            out[n++] = '.';
+            memcpy(out + n, digits + 1, k - 1);
+            n += k - 1;
+        }
+        int ae = e10 < 0 ? -e10 : e10;
+        out[n++] = 'e';
+        out[n++] = e10 < 0 ? '-' : '+';
+        if (ae >= 100)
+            out[n++] = (char)('0' + ae / 100);
+        if (ae >= 10)
+            out[n++] = (char)('0' + ae / 10 % 10);
+        out[n++] = (char)('0' + ae % 10);
+    } else if (e10 < 0) {
+        out[n++] = '0';
+        out[n++] = '.';
+        for (int z = e10 + 1; z < 0; z++)
+            out[n++] = '0';
+        memcpy(out + n, digits, k);
+        n += k;
+    } else {
+        for (int j = 0; j <= e10 || (size_t)j < k; j++) {
+            if (j == e10 + 1)
+                out[n++] = '.';
+            out[n++] = (size_t)j < k ? digits[j] : '0';
+        }
+    }
+    return n;
+}
+
+ll format_double_into(str buf, size_t cap, double x) {
+    PROFILE_SCOPE(0);
+    char out[32];
+    size_t n = format_double_n(out, x);
+    if (cap > 0) {
+        memcpy(buf, out, n < cap-1 ? n : cap-1);
+        buf[n < cap-1 ? n : cap-1] = '\0';
+    }
+    return n;
+}
+
+str format_double(double x) {
+    PROFILE_SCOPE(0);
+    char out[32];
+    size_t n = format_double_n(out, x);
+    str ptr = alloc_safe_str(n);
+    memcpy(ptr, out, n);
+    ptr[n] = '\0';
+    return ptr;
+}
+
+// charset_from("\t\r\n "), spelled out so the whitespace functions don't rebuild it on every call
+const charset WHITESPACE_CS = {
+    .bits = { [1] = 0x26, [4] = 0x01 },
+    .lo = { [0] = 0x04, [9] = 0x01, [10] = 0x01, [13] = 0x01 },
+};
+
+charset charset_from(const char* params) {
+    PROFILE_SCOPE(PROFILE_LEN(params));
+    charset cs;
+    memset(&cs, 0, sizeof(cs));
+    if (params == NULL)
+        return cs;
+    for (const unsigned char* c = (const unsigned char*)params; *c != '\0'; c++) {
+        cs.bits[*c >> 3] |= 1 << (*c & 7);
+        if (*c < 0x80)
+            cs.lo[*c & 15] |= 1 << (*c >> 4);
+        else
+            cs.hi[*c & 15] |= 1 << ((*c >> 4) - 8);
+    }
+    return cs;
+}
+int charset_contains(const charset* cs, char c) {
+    return CS_HAS(cs, c);
+}
+strview sv_trimcs(strview view, const charset* cs) {
+    PROFILE_SCOPE(view.len);
+    return sv_trimendcs(sv_trimstartcs(view, cs), cs);
+}
+strview sv_trimendcs(strview view, const charset* cs) {
+    PROFILE_SCOPE(view.len);
+    while (view.len > 0 && CS_HAS(cs, view.ptr[view.len-1]))
+        view.len--;
+    return view;
+}
+strview sv_trimstartcs(strview view, const charset* cs) {
+    PROFILE_SCOPE(view.len);
+    while (view.len > 0 && CS_HAS(cs, *view.ptr)) {
+        view.ptr++;
+        view.len--;
+    }
+    return view;
+}
+ll sv_findcs(strview haystack, const charset* cs) {
+    PROFILE_SCOPE(haystack.len);
+    return KERNEL(findcs)(haystack.ptr, haystack.len, cs);
+}
+ll sv_rfindcs(strview haystack, const charset* cs) {
+    PROFILE_SCOPE(haystack.len);
+    return KERNEL(rfindcs)(haystack.ptr, haystack.len, cs);
+}
+ll sv_countcs(strview haystack, const charset* cs) {
+    PROFILE_SCOPE(haystack.len);
+    return KERNEL(countcs)(haystack.ptr, haystack.len, cs);
+}
+int sv_splitcs_next(strview* rest, const charset* cs, strview* token) {
+    PROFILE_SCOPE(rest->len);
+    if (rest->ptr == NULL)
+        return 0;
+    ll i = sv_findcs(*rest, cs);
+    token->ptr = rest->ptr;
+    if (i == -1) {
+        token->len = rest->len;
+        rest->ptr = NULL;
+        rest->len = 0;
+        return 1;
+    }
+    token->len = i;
+    rest->ptr += i + 1;
+    rest->len -= i + 1;
+    return 1;
+}
+strview sv_from(const char* string) {
+    strview view = { string, string == NULL ? 0 : strlen(string) };
+    return view;
+}
+strview sv_fromn(const char* string, size_t len) {
+    strview view = { string, len };
+    return view;
+}
+str sv_tostr(strview view) {
+    PROFILE_SCOPE(view.len);
+    if (view.ptr == NULL) {
+        handle_err(NullPtrError, "NULL pointer was trying to be copied\n");
+    }
+    str ptr = alloc_safe_str(view.len);
+    memcpy(ptr, view.ptr, view.len);
+    ptr[view.len] = '\0';
+    return ptr;
+}
+ll sv_into(str buf, size_t cap, strview view) {
+    PROFILE_SCOPE(view.len);
+    if (view.ptr == NULL) {
+        handle_err(NullPtrError, "NULL pointer was trying to be copied\n");
+    }
+    if (cap > 0) {
+        size_t n = view.len < cap-1 ? view.len : cap-1;
+        memmove(buf, view.ptr, n);
+        buf[n] = '\0';
+    }
+    return view.len;
+}
+int sv_equals(strview first, strview second) {
+    PROFILE_SCOPE(first.len);
+    return first.len == second.len && (first.len == 0 || memcmp(first.ptr, second.ptr, first.len) == 0);
+}
+strview sv_trim(strview view) {
+    PROFILE_SCOPE(view.len);
+    return sv_trimcs(view, &WHITESPACE_CS);
+}
+strview sv_trimchar(strview view, char c) {
+    PROFILE_SCOPE(view.len);
+    return sv_trimendchar(sv_trimstartchar(view, c), c);
+}
+strview sv_trimnchar(strview view, const char* params) {
+    PROFILE_SCOPE(view.len);
+    charset cs = charset_from(params);
+    return sv_trimcs(view, &cs);
+}
+strview sv_trimstr(strview view, strview needle) {
+    PROFILE_SCOPE(view.len);
+    return sv_trimendstr(sv_trimstartstr(view, needle), needle);
+}
+strview sv_trimend(strview view) {
+    PROFILE_SCOPE(view.len);
+    return sv_trimendcs(view, &WHITESPACE_CS);
+}
+strview sv_trimendchar(strview view, char c) {
+    PROFILE_SCOPE(view.len);
+    while (view.len > 0 && view.ptr[view.len-1] == c)
+        view.len--;
+    return view;
+}
+strview sv_trimendnchar(strview view, const char* params) {
+    PROFILE_SCOPE(view.len);
+    charset cs = charset_from(params);
+    return sv_trimendcs(view, &cs);
+}
+strview sv_trimendstr(strview view, strview needle) {
+    PROFILE_SCOPE(view.len);
+    if (needle.len == 0)
+        return view;
+    while (sv_endswith(view, needle))
+        view.len -= needle.len;
+    return view;
+}
+strview sv_trimstart(strview view) {
+    PROFILE_SCOPE(view.len);
+    return sv_trimstartcs(view, &WHITESPACE_CS);
+}
+strview sv_trimstartchar(strview view, char c) {
+    PROFILE_SCOPE(view.len);
+    while (view.len > 0 && *view.ptr == c) {
+        view.ptr++;
+        view.len--;
+    }
+    return view;
+}
+strview sv_trimstartnchar(strview view, const char* params) {
+    PROFILE_SCOPE(view.len);
+    charset cs = charset_from(params);
+    return sv_trimstartcs(view, &cs);
+}
+strview sv_trimstartstr(strview view, strview needle) {
+    PROFILE_SCOPE(view.len);
+    if (needle.len == 0)
+        return view;
+    while (sv_startswith(view, needle)) {
+        view.ptr += needle.len;
+        view.len -= needle.len;
+    }
+    return view;
+}
+strview sv_substr(strview view, size_t start, size_t end) {
+    if (end > view.len)
+        end = view.len;
+    if (start > end)
+        start = end;
+    view.ptr += start;
+    view.len = end - start;
+    return view;
+}
+int sv_startswith(strview haystack, strview needle) {
+    PROFILE_SCOPE(haystack.len);
+    return needle.len <= haystack.len && (needle.len == 0 || memcmp(haystack.ptr, needle.ptr, needle.len) == 0);
+}
+int sv_endswith(strview haystack, strview needle) {
+    PROFILE_SCOPE(haystack.len);
+    return needle.len <= haystack.len && (needle.len == 0 || memcmp(haystack.ptr+haystack.len-needle.len, needle.ptr, needle.len) == 0);
+}
+ll sv_find(strview haystack, strview needle) {
+    PROFILE_SCOPE(haystack.len);
+    compiled_needle cn;
+    needle_init(&cn, needle.ptr, needle.len, NEEDLE_FORWARD);
+    return needle_find(&cn, haystack.ptr, haystack.len);
+}
+ll sv_rfind(strview haystack, strview needle) {
+    PROFILE_SCOPE(haystack.len);
+    compiled_needle cn;
+    needle_init(&cn, needle.ptr, needle.len, NEEDLE_REVERSE);
+    return needle_rfind(&cn, haystack.ptr, haystack.len);
+}
+ll sv_findc(strview haystack, char needle) {
+    PROFILE_SCOPE(haystack.len);
+    return KERNEL(findc)(haystack.ptr, haystack.len, needle);
+}
+ll sv_rfindc(strview haystack, char needle) {
+    PROFILE_SCOPE(haystack.len);
+    return KERNEL(rfindc)(haystack.ptr, haystack.len, needle);
+}
+ll sv_findnc(strview haystack, const char* params) {
+    PROFILE_SCOPE(haystack.len);
+    charset cs = charset_from(params);
+    return sv_findcs(haystack, &cs);
+}
+ll sv_rfindnc(strview haystack, const char* params) {
+    PROFILE_SCOPE(haystack.len);
+    charset cs = charset_from(params);
+    return sv_rfindcs(haystack, &cs);
+}
+ll sv_count(strview haystack, strview needle) {
+    PROFILE_SCOPE(haystack.len);
+    if (needle.len == 0)
+        return haystack.len + 1;
+    compiled_needle cn;
+    needle_init(&cn, needle.ptr, needle.len, NEEDLE_FORWARD);
+    size_t chunks = parallel_chunks(haystack.len);
+    if (chunks > 1 && needle.len > 0)
+        return parallel_count(&cn, haystack.ptr, haystack.len, chunks);
+    return needle_count(&cn, haystack.ptr, haystack.len);
+}
+ll sv_countc(strview haystack, char c) {
+    PROFILE_SCOPE(haystack.len);
+    size_t chunks = parallel_chunks(haystack.len);
+    if (chunks > 1)
+        return parallel_countc(haystack.ptr, haystack.len, c, chunks);
+    return KERNEL(countc)(haystack.ptr, haystack.len, c);
+}
+int sv_split_next(strview* rest, strview* token) {
+    PROFILE_SCOPE(rest->len);
+    while (sv_splitcs_next(rest, &WHITESPACE_CS, token)) {
+        if (token->len != 0)
+            return 1;
+    }
+    return 0;
+}
+int sv_splitc_next(strview* rest, char c, strview* token) {
+    PROFILE_SCOPE(rest->len);
+    if (rest->ptr == NULL)
+        return 0;
+    ll i = sv_findc(*rest, c);
+    token->ptr = rest->ptr;
+    if (i == -1) {
+        token->len = rest->len;
+        rest->ptr = NULL;
+        rest->len = 0;
+        return 1;
+    }
+    token->len = i;
+    rest->ptr += i + 1;
+    rest->len -= i + 1;
+    return 1;
+}
+int sv_splitnc_next(strview* rest, const char* params, strview* token) {
+    PROFILE_SCOPE(rest->len);
+    charset cs = charset_from(params);
+    return sv_splitcs_next(rest, &cs, token);
+}
+int sv_splitstr_next(strview* rest, strview needle, strview* token) {
+    PROFILE_SCOPE(rest->len);
+    if (needle.len == 0) {
+        handle_err(EmptySeparator, "Split attempt with empty separator\n");
+    }
+    if (rest->ptr == NULL)
+        return 0;
+    ll i = sv_find(*rest, needle);
+    token->ptr = rest->ptr;
+    if (i == -1) {
+        token->len = rest->len;
+        rest->ptr = NULL;
+        rest->len = 0;
+        return 1;
+    }
+    token->len = i;
+    rest->ptr += i + needle.len;
+    rest->len -= i + needle.len;
+    return 1;
+}
+
+// Reads up to n bytes from file (or fd when file is NULL), retrying on EINTR
+// Returns the number of bytes read, 0 at the end of the input and -1 after raising ReadError
+ll read_input(FILE* file, int fd, str buf, size_t n) {
+    for (;;) {
+        ll got;
+        if (file != NULL) {
+            got = (ll)fread(buf, 1, n, file);
+            if (got > 0 || !ferror(file))
+                return got;
+        } else {
+            got = READ_FD(fd, buf, n);
+            if (got >= 0)
+                return got;
+        }
+        if (errno == EINTR) {
+            if (file != NULL)
+                clearerr(file);
+            continue;
+        }
+        handle_err(ReadError, "Reading the input failed: %s\n", strerror(errno));
+        return -1;
+    }
+}
+
+token_separator sep_whitespace(void) {
+    token_separator sep;
+    memset(&sep, 0, sizeof(sep));
+    sep.kind = SepWhitespace;
+    sep.cs = WHITESPACE_CS;
+    return sep;
+}
+token_separator sep_char(char c) {
+    token_separator sep;
+    memset(&sep, 0, sizeof(sep));
+    sep.kind = SepChar;
+    sep.c = c;
+    return sep;
+}
+token_separator sep_charset(const char* params) {
+    if (params == NULL || params[0] == '\0') {
+        handle_err(EmptySeparator, "Split attempt with empty separator\n");
+    }
+    token_separator sep;
+    memset(&sep, 0, sizeof(sep));
+    sep.kind = SepCharset;
+    sep.cs = charset_from(params);
+    return sep;
+}
+token_separator sep_string(const char* needle) {
+    if (needle == NULL || needle[0] == '\0') {
+        handle_err(EmptySeparator, "Split attempt with empty separator\n");
+    }
+    token_separator sep;
+    memset(&sep, 0, sizeof(sep));
+    sep.kind = SepString;
+    sep.needle = sv_from(needle);
+    return sep;
+}
+
+ll sep_find(const token_separator* sep, const compiled_needle* cn, const char* ptr, size_t len, size_t* seplen) {
+    *seplen = 1;
+    switch (sep->kind) {
+        case SepChar:
+            return KERNEL(findc)(ptr, len, sep->c);
+        case SepString:
+            *seplen = sep->needle.len;
+            return needle_find(cn, ptr, len);
+        default:
+            return KERNEL(findcs)(ptr, len, &sep->cs);
+    }
+}
+
+stream_tokenizer* tokenizer_new(FILE* file, int fd, token_separator sep, size_t buffer_size) {
+    if (buffer_size == 0)
+        buffer_size = TOKENIZER_BUFFER;
+    if (sep.kind == SepString && buffer_size <= sep.needle.len)
+        buffer_size = sep.needle.len + 1;
+    stream_tokenizer* tok = (stream_tokenizer*)safe_alloc_generic(sizeof(stream_tokenizer), 1);
+    tok->buf = (str)safe_alloc_generic(1, buffer_size);
+    tok->file = file;
+    tok->fd = fd;
+    tok->cap = buffer_size;
+    tok->sep = sep;
+    if (sep.kind == SepString)
+        needle_init(&tok->cn, sep.needle.ptr, sep.needle.len, NEEDLE_FORWARD);
+    return tok;
+}
+stream_tokenizer* tokenizer_open_file(FILE* file, token_separator sep, size_t buffer_size) {
+    PROFILE_SCOPE(0);
+    if (file == NULL) {
+        handle_err(NullPtrError, "NULL pointer was trying to be tokenized\n");
+    }
+    return tokenizer_new(file, -1, sep, buffer_size);
+}
+stream_tokenizer* tokenizer_open_fd(int fd, token_separator sep, size_t buffer_size) {
+    PROFILE_SCOPE(0);
+    return tokenizer_new(NULL, fd, sep, buffer_size);
+}
+
+int tokenizer_next(stream_tokenizer* tok, strview* token) {
+    PROFILE_SCOPE(0);
+    size_t seplen;
+    for (;;) {
+        if (tok->done)
+            return 0;
+        // Everything before scanned is known not to hold the start of a separator
+        size_t from = tok->scanned;
+        ll i = sep_find(&tok->sep, &tok->cn, tok->buf+tok->start+from, tok->end-tok->start-from, &seplen);
+        if (i != -1) {
+            token->ptr = tok->buf + tok->start;
+            token->len = from + i;
+            tok->start += from + i + seplen;
+            tok->scanned = 0;
+            // An empty piece still has to end a token that was handed out truncated
+            if (tok->sep.kind == SepWhitespace && token->len == 0 && !tok->truncated)
+                continue;
+            tok->truncated = 0;
+            return 1;
+        }
+        size_t pending = tok->end - tok->start;
+        tok->scanned = pending >= seplen ? pending - (tok->sep.kind == SepString ? seplen - 1 : 0) : 0;
+        if (tok->eof) {
+            tok->done = 1;
+            token->ptr = tok->buf + tok->start;
+            token->len = pending;
+            tok->start = tok->end;
+            if (tok->sep.kind == SepWhitespace && token->len == 0 && !tok->truncated)
+                return 0;
+            tok->truncated = 0;
+            return 1;
+        }
+        if (tok->start > 0) {
+            memmove(tok->buf, tok->buf + tok->start, pending);
+            tok->start = 0;
+            tok->end = pending;
+        }
+        if (tok->end == tok->cap) {
+            // The token doesn't fit in the buffer, it gets handed out in pieces (keeping what could be the start of a separator)
+            size_t keep = tok->sep.kind == SepString ? tok->sep.needle.len - 1 : 0;
+            token->ptr = tok->buf;
+            token->len = tok->end - keep;
+            tok->start = token->len;
+            tok->scanned = 0;
+            tok->truncated = 1;
+            return 1;
+        }
+        ll n = read_input(tok->file, tok->fd, tok->buf + tok->end, tok->cap - tok->end);
+        if (n <= 0) {
+            tok->eof = 1;
+            tok->error = n < 0;
+        } else {
+            tok->end += n;
+        }
+    }
+}
+
+void tokenizer_close(stream_tokenizer* tok) {
+    if (tok == NULL)
+        return;
+    free(tok->buf);
+    free(tok);
+}
+
+csv_reader* csv_new(FILE* file, int fd, strview input, char delim, size_t buffer_size) {
+    if (delim == '"' || delim == '\n' || delim == '\r') {
+        handle_err(InvalidPattern, "%d can't be used as a delimiter\n", delim);
+        return NULL;
+    }
+    csv_reader* csv = (csv_reader*)safe_alloc_generic(sizeof(csv_reader), 1);
+    csv->file = file;
+    csv->fd = fd;
+    csv->delim = delim;
+    if (file == NULL && fd == -1) {
+        csv->data = input.ptr;
+        csv->end = input.len;
+        csv->eof = 1;
+    } else {
+        csv->cap = buffer_size > 0 ? buffer_size : TOKENIZER_BUFFER;
+        csv->buf = (str)safe_alloc_generic(1, csv->cap);
+        csv->data = csv->buf;
+    }
+    csv->field_cap = 16;
+    csv->fields = (strview*)safe_alloc_generic(sizeof(strview), csv->field_cap);
+    return csv;
+}
+csv_reader* csv_open(strview input, char delim) {
+    PROFILE_SCOPE(input.len);
+    if (input.ptr == NULL && input.len > 0) {
+        handle_err(NullPtrError, "NULL pointer was trying to be read as csv\n");
+        return NULL;
+    }
+    return csv_new(NULL, -1, input, delim, 0);
+}
+csv_reader* csv_open_file(FILE* file, char delim, size_t buffer_size) {
+    PROFILE_SCOPE(0);
+    if (file == NULL) {
+        handle_err(NullPtrError, "NULL pointer was trying to be read as csv\n");
+        return NULL;
+    }
+    return csv_new(file, -1, sv_fromn(NULL, 0), delim, buffer_size);
+}
+csv_reader* csv_open_fd(int fd, char delim, size_t buffer_size) {
+    PROFILE_SCOPE(0);
+    return csv_new(NULL, fd, sv_fromn(NULL, 0), delim, buffer_size);
+}
+
+// Field i of the record being read goes from index from to to of data
+void csv_push(csv_reader* csv, size_t i, size_t from, size_t to, int last) {
+    if (i == csv->field_cap) {
+        strview* fields = realloc(csv->fields, sizeof(strview) * csv->field_cap * 2);
+        if (fields == NULL) {
+            handle_err(NullPtrError, "Memory %lu bytes couldn't be alloc'd\n", (ulint)(sizeof(strview) * csv->field_cap * 2));
+            return;
+        }
+        csv->fields = fields;
+        csv->field_cap *= 2;
+    }
+    if (last && to > from && csv->data[to-1] == '\r')
+        to--;
+    csv->fields[i] = sv_fromn(csv->data + from, to - from);
+}
+
+// Drops what's before the current record from the read buffer (or grows it if the record fills it) and reads more.
+// The first count fields, already found in the current record, are moved along.
+void csv_fill(csv_reader* csv, size_t count) {
+    str buf = csv->buf;
+    size_t shift = csv->start;
+    if (shift > 0) {
+        memmove(buf, buf + shift, csv->end - shift);
+        csv->end -= shift;
+        csv->scanned -= shift;
+        csv->start = 0;
+    } else if (csv->end == csv->cap) {
+        buf = (str)safe_alloc_generic(1, csv->cap * 2);
+        if (buf == NULL) {
+            csv->eof = 1;
+            csv->error = 1;
+            return;
+        }
+        memcpy(buf, csv->buf, csv->end);
+        csv->cap *= 2;
+    }
+    for (size_t i = 0; i < count; i++)
+        csv->fields[i].ptr = buf + (csv->fields[i].ptr - csv->buf) - shift;
+    if (buf != csv->buf) {
+        free(csv->buf);
+        csv->buf = buf;
+    }
+    csv->data = buf;
+    ll n = read_input(csv->file, csv->fd, csv->buf + csv->end, csv->cap - csv->end);
+    if (n <= 0) {
+        csv->eof = 1;
+        csv->error = n < 0;
+    } else
+        csv->end += n;
+}
+
+size_t csv_next(csv_reader* csv, strview** fields) {
+    PROFILE_SCOPE(0);
+    if (csv == NULL || fields == NULL) {
+        handle_err(NullPtrError, "NULL pointer was passed to csv_next\n");
+        return 0;
+    }
+    size_t count = 0, field = csv->start;
+    *fields = csv->fields;
+    for (;;) {
+        if (csv->pending == 0) {
+            if (csv->scanned + 64 <= csv->end) {
+                csv->block = csv->scanned;
+                csv->pending = KERNEL(csvblock)(csv->data + csv->scanned, csv->delim, &csv->inside);
+                csv->scanned += 64;
+                continue;
+            }
+            if (!csv->eof) {
+                size_t offset = field - csv->start;
+                csv_fill(csv, count);
+                field = csv->start + offset;
+                *fields = csv->fields;
+                continue;
+            }
+            if (csv->scanned < csv->end) {
+                // The last few bytes get classified from a padded copy, the padding must not count as delimiters
+                char last[64];
+                size_t n = csv->end - csv->scanned;
+                memset(last, 0, sizeof(last));
+                memcpy(last, csv->data + csv->scanned, n);
+                csv->block = csv->scanned;
+                csv->pending = KERNEL(csvblock)(last, csv->delim, &csv->inside) & ((1ULL << n) - 1);
+                csv->scanned = csv->end;
+                continue;
+            }
+            // The input is over, what's left is the last record unless the input ended with a newline
+            if (count == 0 && field == csv->end)
+                return 0;
+            csv_push(csv, count++, field, csv->end, 1);
+            csv->start = csv->end;
+            *fields = csv->fields;
+            return count;
+        }
+        size_t at = csv->block + __builtin_ctzll(csv->pending);
+        int newline = csv->data[at] == '\n';
+        csv->pending &= csv->pending - 1;
+        csv_push(csv, count++, field, at, newline);
+        field = at + 1;
+        if (newline) {
+            csv->start = field;
+            *fields = csv->fields;
+            return count;
+        }
+    }
+}
+
+ll csv_unescape_into(str buf, size_t cap, strview field) {
+    PROFILE_SCOPE(field.len);
+    if (field.ptr == NULL && field.len > 0) {
+        handle_err(NullPtrError, "NULL pointer was trying to be unescaped\n");
+        return 0;
+    }
+    size_t n = 0;
+    int quoted = 0;
+    for (size_t i = 0; i < field.len; i++) {
+        char c = field.ptr[i];
+        if (c == '"') {
+            if (!quoted || i + 1 == field.len || field.ptr[i+1] != '"') {
+                quoted ^= 1;
+                continue;
+            }
+            i++;
+        }
+        if (n + 1 < cap)
+            buf[n] = c;
+        n++;
+    }
+    if (cap > 0)
+        buf[n < cap ? n : cap-1] = '\0';
+    return n;
+}
+
+str csv_unescape(strview field) {
+    PROFILE_SCOPE(field.len);
+    str ptr = alloc_safe_str(field.len);
+    csv_unescape_into(ptr, field.len + 1, field);
+    return ptr;
+}
+
+void csv_close(csv_reader* csv) {
+    if (csv == NULL)
+        return;
+    free(csv->fields);
+    free(csv->buf);
+    free(csv);
+}
+
+void index_lines(mapped_file* mf) {
+    // The line count isn't known up front, sizing from the file would reserve gigabytes for files that have few lines
+    size_t cap = 256;
+    mf->lines = (size_t*)safe_alloc_generic(sizeof(size_t), cap);
+    mf->lines[0] = 0;
+    mf->count = 1;
+    size_t pos = 0;
+    ll i;
+    while ((i = KERNEL(findc)(mf->data + pos, mf->size - pos, '\n')) != -1) {
+        pos += i + 1;
+        if (mf->count + 1 == cap) {
+            size_t* lines = realloc(mf->lines, sizeof(size_t) * cap * 2);
+            if (lines == NULL) {
+                handle_err(NullPtrError, "Memory %lu bytes couldn't be alloc'd\n", (ulint)(sizeof(size_t) * cap * 2));
+                break;
+            }
+            mf->lines = lines;
+            cap *= 2;
+        }
+        mf->lines[mf->count++] = pos;
+    }
+    // Sentinel, so that line i always ends at lines[i+1]-1
+    mf->lines[mf->count] = mf->size + 1;
+}
+
+mapped_file* map_file(const char* path) {
+    PROFILE_SCOPE(0);
+    if (path == NULL) {
+        handle_err(NullPtrError, "NULL pointer was trying to be mapped\n");
+    }
+    mapped_file* mf = (mapped_file*)safe_alloc_generic(sizeof(mapped_file), 1);
+#ifdef _WIN32
+    FILE* file = fopen(path, "rb");
+    if (file == NULL) {
+        free(mf);
+        return NULL;
+    }
+    // ftell() returns a long, which is 32 bits on Windows
+    _fseeki64(file, 0, SEEK_END);
+    __int64 size = _ftelli64(file);
+    _fseeki64(file, 0, SEEK_SET);
+    str data = (str)safe_alloc_generic(1, size > 0 ? size : 1);
+    mf->size = size > 0 ? fread(data, 1, size, file) : 0;
+    fclose(file);
+    mf->data = data;
+#else
+    int fd = open(path, O_RDONLY);
+    struct stat st;
+    if (fd == -1 || fstat(fd, &st) == -1) {
+        if (fd != -1)
+            close(fd);
+        free(mf);
+        return NULL;
+    }
+    mf->size = st.st_size;
+    if (mf->size > 0) {
+        void* data = mmap(NULL, mf->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data == MAP_FAILED) {
+            close(fd);
+            free(mf);
+            return NULL;
+        }
+        mf->data = data;
+        mf->mapped = 1;
+#ifdef MADV_SEQUENTIAL      // Hidden by strict -std=c11 without _DEFAULT_SOURCE
+        madvise(data, mf->size, MADV_SEQUENTIAL);
+#endif
+    } else {
+        mf->data = "";
+    }
+    close(fd);
+#endif
+    index_lines(mf);
+#if !defined(_WIN32) && defined(MADV_NORMAL)
+    if (mf->mapped)
+        madvise((void*)mf->data, mf->size, MADV_NORMAL);
+#endif
+    return mf;
+}
+
+strview mf_line(const mapped_file* mf, size_t index) {
+    if (mf == NULL) {
+        handle_err(NullPtrError, "NULL pointer was trying to be accessed\n");
+    }
+    if (index >= mf->count) {
+        handle_err(InvalidSubstringIndex, "Line %lu is out of range (%lu lines)\n", (ulint)index, (ulint)mf->count);
+    }
+    return sv_fromn(mf->data + mf->lines[index], mf->lines[index+1] - 1 - mf->lines[index]);
+}
+
+strview mf_view(const mapped_file* mf) {
+    if (mf == NULL) {
+        handle_err(NullPtrError, "NULL pointer was trying to be accessed\n");
+    }
+    return sv_fromn(mf->data, mf->size);
+}
+
+size_t sv_splitc_into(strview view, char c, strview* fields, size_t max) {
+    PROFILE_SCOPE(view.len);
+    size_t n = 0;
+    for (;;) {
+        ll i = KERNEL(findc)(view.ptr, view.len, c);
+        size_t len = i == -1 ? view.len : (size_t)i;
+        if (n < max)
+            fields[n] = sv_fromn(view.ptr, len);
+        n++;
+        if (i == -1)
+            return n;
+        view.ptr += len + 1;
+        view.len -= len + 1;
+    }
+}
+
+void unmap_file(mapped_file* mf) {
+    if (mf == NULL)
+        return;
+#ifdef _WIN32
+    free((str)mf->data);
+#else
+    if (mf->mapped)
+        munmap((void*)mf->data, mf->size);
+#endif
+    free(mf->lines);
+    free(mf);
+}
+
+unsigned int rope_priority(void) {
+    // xorshift64*, good enough to keep the treap balanced in expectation
+    ROPE_SEED ^= ROPE_SEED >> 12;
+    ROPE_SEED ^= ROPE_SEED << 25;
+    ROPE_SEED ^= ROPE_SEED >> 27;
+    return (unsigned int)((ROPE_SEED * 0x2545F4914F6CDD1DULL) >> 32);
+}
+
+rope_node* rope_node_new(rope_chunk* chunk, const char* ptr, size_t len) {
+    rope_node* node = (rope_node*)safe_alloc_generic(sizeof(rope_node), 1);
+    node->chunk = chunk;
+    node->ptr = ptr;
+    node->len = len;
+    node->total = len;
+    node->refs = 1;
+    node->priority = rope_priority();
+    chunk->refs++;
+    return node;
+}
+
+rope_node* rope_text_node(strview text) {
+    rope_chunk* chunk = (rope_chunk*)safe_alloc_generic(sizeof(rope_chunk) + text.len, 1);
+    memcpy(chunk->data, text.ptr, text.len);
+    rope_node* node = rope_node_new(chunk, chunk->data, text.len);
+    return node;
+}
+
+rope_node* rope_retain(rope_node* node) {
+    if (node != NULL)
+        node->refs++;
+    return node;
+}
+
+void rope_release(rope_node* node) {
+    while (node != NULL && --node->refs == 0) {
+        rope_node* right = node->right;
+        rope_release(node->left);
+        if (--node->chunk->refs == 0)
+            free(node->chunk);
+        free(node);
+        node = right;
+    }
+}
+
+size_t rope_total(const rope_node* node) {
+    return node != NULL ? node->total : 0;
+}
+
+void rope_update(rope_node* node) {
+    node->total = rope_total(node->left) + node->len + rope_total(node->right);
+}
+
+// Nodes are shared between ropes (see rope_substr()), a node has to be unique before it can be modified
+rope_node* rope_unique(rope_node* node) {
+    if (node->refs == 1)
+        return node;
+    rope_node* copy = rope_node_new(node->chunk, node->ptr, node->len);
+    copy->priority = node->priority;
+    copy->left = rope_retain(node->left);
+    copy->right = rope_retain(node->right);
+    copy->total = node->total;
+    node->refs--;
+    return copy;
+}
+
+// Both merge and split take over the references they're given
+rope_node* rope_merge(rope_node* a, rope_node* b) {
+    if (a == NULL)
+        return b;
+    if (b == NULL)
+        return a;
+    if (a->priority > b->priority) {
+        a = rope_unique(a);
+        a->right = rope_merge(a->right, b);
+        rope_update(a);
+        return a;
+    }
+    b = rope_unique(b);
+    b->left = rope_merge(a, b->left);
+    rope_update(b);
+    return b;
+}
+
+void rope_split(rope_node* node, size_t pos, rope_node** left, rope_node** right) {
+    if (node == NULL) {
+        *left = *right = NULL;
+        return;
+    }
+    node = rope_unique(node);
+    size_t before = rope_total(node->left);
+    if (pos <= before) {
+        rope_split(node->left, pos, left, &node->left);
+        rope_update(node);
+        *right = node;
+    } else if (pos >= before + node->len) {
+        rope_split(node->right, pos - before - node->len, &node->right, right);
+        rope_update(node);
+        *left = node;
+    } else {
+        // The split falls inside this piece: it's cut in two, both halves keep pointing in the same chunk
+        size_t k = pos - before;
+        rope_node* rest = rope_node_new(node->chunk, node->ptr + k, node->len - k);
+        rope_node* after = node->right;
+        node->len = k;
+        node->right = NULL;
+        rope_update(node);
+        *left = node;
+        *right = rope_merge(rest, after);
+    }
+}
+
+rope* rope_from(strview text) {
+    PROFILE_SCOPE(text.len);
+    if (text.ptr == NULL) {
+        handle_err(NullPtrError, "NULL pointer was trying to be copied\n");
+    }
+    rope* r = (rope*)safe_alloc_generic(sizeof(rope), 1);
+    if (text.len > 0)
+        r->root = rope_text_node(text);
+    return r;
+}
+
+size_t rope_length(const rope* r) {
+    return rope_total(r->root);
+}
+
+void rope_insert(rope* r, size_t pos, strview text) {
+    PROFILE_SCOPE(text.len);
+    if (text.ptr == NULL) {
+        handle_err(NullPtrError, "NULL pointer was trying to be inserted\n");
+    }
+    if (pos > rope_length(r)) {
+        handle_err(InvalidSubstringIndex, "Rope insert at %lu past the end (%lu)\n", (ulint)pos, (ulint)rope_length(r));
+    }
+    if (text.len == 0)
+        return;
+    rope_node *left, *right;
+    rope_split(r->root, pos, &left, &right);
+    r->root = rope_merge(rope_merge(left, rope_text_node(text)), right);
+}
+
+void rope_append(rope* r, strview text) {
+    PROFILE_SCOPE(text.len);
+    rope_insert(r, rope_length(r), text);
+}
+
+void rope_erase(rope* r, size_t pos, size_t len) {
+    PROFILE_SCOPE(len);
+    size_t total = rope_length(r);
+    if (pos > total || len > total - pos) {
+        handle_err(InvalidSubstringIndex, "Rope erase of %lu:%lu past the end (%lu)\n", (ulint)pos, (ulint)(pos+len), (ulint)total);
+    }
+    rope_node *left, *mid, *right;
+    rope_split(r->root, pos, &left, &right);
+    rope_split(right, len, &mid, &right);
+    rope_release(mid);
+    r->root = rope_merge(left, right);
+}
+
+rope* rope_substr(const rope* r, size_t start, size_t end) {
+    PROFILE_SCOPE(0);
+    if (start > end || end > rope_length(r)) {
+        handle_err(InvalidSubstringIndex, "Rope substring received invalid range %lu:%lu\n", (ulint)start, (ulint)end);
+    }
+    rope* sub = (rope*)safe_alloc_generic(sizeof(rope), 1);
+    rope_node *left, *mid, *right;
+    rope_split(rope_retain(r->root), start, &left, &right);
+    rope_split(right, end - start, &mid, &right);
+    rope_release(left);
+    rope_release(right);
+    sub->root = mid;
+    return sub;
+}
+
+void rope_concat(rope* r, const rope* other) {
+    PROFILE_SCOPE(0);
+    r->root = rope_merge(r->root, rope_retain(other->root));
+}
+
+void rope_iter_init(rope_iter* it, const rope* r, size_t pos) {
+    it->source = r;
+    it->pos = pos;
+}
+
+int rope_next(rope_iter* it, strview* piece) {
+    const rope_node* node = it->source->root;
+    size_t pos = it->pos;
+    while (node != NULL) {
+        size_t before = rope_total(node->left);
+        if (pos < before) {
+            node = node->left;
+        } else if (pos < before + node->len) {
+            piece->ptr = node->ptr + (pos - before);
+            piece->len = node->len - (pos - before);
+            it->pos += piece->len;
+            return 1;
+        } else {
+            pos -= before + node->len;
+            node = node->right;
+        }
+    }
+    return 0;
+}
 
-#define MAX_STRINGS 1000
-#ifndef SIGUSR1
-#define SIGUSR1 SIGTERM     // For some reason Windows doesn't let you use user defined errors.
-#endif
-#define MAX_VECT 500
-#define str char*
-#define vstr char**
-#define uint unsigned int
-#define ulint unsigned long int
-#define ll long long
-#define p(name) (*name)
-#define tp(type, name) type *name
+// Calls found() for the occurrences starting at from or later, in order. found() returns where the next occurrence
+// it cares about can start, ROPE_STOP to end the scan. Occurrences that straddle pieces are looked for in a seam
+// made of the last m-1 bytes before a piece and its first m-1 bytes.
+void rope_scan(const rope* r, size_t from, const compiled_needle* cn, size_t (*found)(void* ctx, size_t pos), void* ctx) {
+    size_t m = cn->len, tail = 0, pos = from, next = from;
+    char stack[2 * SHORT_NEEDLE];
+    str seam = 2 * m <= sizeof(stack) ? stack : (str)safe_alloc_generic(1, 2 * m);
+    rope_iter it;
+    strview piece;
+    ll i;
+    rope_iter_init(&it, r, from);
+    while (m > 0 && next != ROPE_STOP && rope_next(&it, &piece)) {
+        if (tail > 0 && next < pos) {
+            size_t head = piece.len < m - 1 ? piece.len : m - 1, at = next > pos - tail ? next - (pos - tail) : 0;
+            memcpy(seam + tail, piece.ptr, head);
+            while (at < tail && (i = needle_find(cn, seam + at, tail + head - at)) != -1 && at + i < tail) {
+                next = found(ctx, pos - tail + at + i);
+                if (next == ROPE_STOP)
+                    goto done;
+                at = next - (pos - tail);
+            }
+        }
+        size_t at = next > pos ? next - pos : 0;
+        while (at < piece.len && (i = needle_find(cn, piece.ptr + at, piece.len - at)) != -1) {
+            next = found(ctx, pos + at + i);
+            if (next == ROPE_STOP)
+                goto done;
+            at = next - pos;
+        }
+        // Keep the last m-1 bytes seen for the next seam
+        if (piece.len >= m - 1) {
+            memcpy(seam, piece.ptr + piece.len - (m - 1), m - 1);
+            tail = m - 1;
+        } else {
+            size_t keep = tail + piece.len > m - 1 ? m - 1 - piece.len : tail;
+            memmove(seam, seam + tail - keep, keep);
+            memcpy(seam + keep, piece.ptr, piece.len);
+            tail = keep + piece.len;
+        }
+        pos += piece.len;
+    }
+done:
+    if (seam != stack)
+        free(seam);
+}
 
-alloced_strings structs = { NULL, 0, MAX_STRINGS};
-alloced_vects vstructs = { NULL, 0, MAX_VECT};
-int SIGNAL_USR_StringUtils = 0;
-StringUtilsTraceLvl TRACE_LVL = NoTrace;
+typedef struct rope_matches {
+    size_t* offsets;
+    size_t count;
+    size_t cap;
+    size_t len;
+} rope_matches;
 
-#ifdef __GNUC__             // __attribute__((constructor)) is only present in GCC, therefore we need to check this.
-    #ifndef __clang__
-void init(void) __attribute__((constructor));
+size_t rope_first(void* ctx, size_t pos) {
+    *(ll*)ctx = pos;
+    return ROPE_STOP;
+}
 
-void init(void) {
-    atexit(free_all_structures);
+size_t rope_tally(void* ctx, size_t pos) {
+    (*(ll*)ctx)++;
+    return pos + 1;
 }
-    #endif
-#endif
 
-void handle_err(StringUtilsErrors error_type, const char *_Format, ...) {
-    va_list args;
-    va_start(args, _Format);
-    if (!SIGNAL_USR_StringUtils) {
-        vprintf(_Format, args);
-        exit(error_type);
+size_t rope_collect(void* ctx, size_t pos) {
+    rope_matches* matches = ctx;
+    if (matches->count == matches->cap) {
+        matches->cap = matches->cap ? 2 * matches->cap : 64;
+        matches->offsets = realloc(matches->offsets, sizeof(size_t) * matches->cap);
+        if (matches->offsets == NULL) {
+            handle_err(NullPtrError, "Memory %lu bytes couldn't be alloc'd\n", (ulint)(sizeof(size_t) * matches->cap));
+        }
     }
-    else {
-        if (TRACE_LVL != NoTrace)
-            fprintf(stderr,"[Warn: triggered exception handled by the user] Err: %s\n", errcodetostr_stringutils(error_type));
-        raise(SIGUSR1);
+    matches->offsets[matches->count++] = pos;
+    return pos + matches->len;
+}
+
+ll rope_find(const rope* r, strview needle, size_t from) {
+    PROFILE_SCOPE(rope_length(r));
+    if (from > rope_length(r))
+        return -1;
+    if (needle.len == 0)
+        return from;
+    compiled_needle cn;
+    needle_init(&cn, needle.ptr, needle.len, NEEDLE_FORWARD);
+    ll at = -1;
+    rope_scan(r, from, &cn, rope_first, &at);
+    return at;
+}
+
+ll rope_count(const rope* r, strview needle) {
+    PROFILE_SCOPE(rope_length(r));
+    compiled_needle cn;
+    needle_init(&cn, needle.ptr, needle.len, NEEDLE_FORWARD);
+    ll n = 0;
+    rope_scan(r, 0, &cn, rope_tally, &n);
+    return n;
+}
+
+ll rope_replace(rope* r, strview needle, strview rep) {
+    PROFILE_SCOPE(rope_length(r));
+    if (needle.ptr == NULL || rep.ptr == NULL) {
+        handle_err(NullPtrError, "NULL pointer was trying to be replaced\n");
     }
-    va_end(args);
+    compiled_needle cn;
+    needle_init(&cn, needle.ptr, needle.len, NEEDLE_FORWARD);
+    rope_matches matches = { NULL, 0, 0, needle.len };
+    rope_scan(r, 0, &cn, rope_collect, &matches);
+    if (matches.count == 0)
+        return 0;
+    // Every occurrence becomes a piece pointing at the same copy of rep
+    rope_node* with = rep.len > 0 ? rope_text_node(rep) : NULL;
+    rope_node *out = NULL, *rest = r->root, *left, *mid;
+    size_t done = 0;
+    for (size_t i = 0; i < matches.count; i++) {
+        rope_split(rest, matches.offsets[i] - done, &left, &rest);
+        rope_split(rest, needle.len, &mid, &rest);
+        rope_release(mid);
+        out = rope_merge(out, left);
+        if (with != NULL)
+            out = rope_merge(out, rope_node_new(with->chunk, with->ptr, with->len));
+        done = matches.offsets[i] + needle.len;
+    }
+    r->root = rope_merge(out, rest);
+    rope_release(with);
+    free(matches.offsets);
+    return matches.count;
+}
+
+void rope_copy(const rope_node* node, str dst) {
+    while (node != NULL) {
+        rope_copy(node->left, dst);
+        dst += rope_total(node->left);
+        memcpy(dst, node->ptr, node->len);
+        dst += node->len;
+        node = node->right;
+    }
+}
+
+str rope_flatten(const rope* r) {
+    PROFILE_SCOPE(rope_length(r));
+    size_t len = rope_length(r);
+    str ptr = alloc_safe_str(len);
+    rope_copy(r->root, ptr);
+    ptr[len] = '\0';
+    return ptr;
+}
+
+void rope_free(rope* r) {
+    if (r == NULL)
+        return;
+    rope_release(r->root);
+    free(r);
 }
 
 str trim(str string) {
-    return trimnchar(string, "\t\r\n ");
+    PROFILE_SCOPE(PROFILE_LEN(string));
+    return sv_tostr(sv_trim(sv_from(string)));
 }
 str trimchar(str string, char c) {
-    return trimendchar(trimstartchar(string, c), c);
+    PROFILE_SCOPE(PROFILE_LEN(string));
+    return sv_tostr(sv_trimchar(sv_from(string), c));
 }
 str trimnchar(str string, str params) {
-    return trimendnchar(trimstartnchar(string, params), params);
+    PROFILE_SCOPE(PROFILE_LEN(string));
+    return sv_tostr(sv_trimnchar(sv_from(string), params));
 }
 str trimstr(str string, str needle) {
-    return trimendstr(trimstartstr(string, needle), needle);
+    PROFILE_SCOPE(PROFILE_LEN(string));
+    return sv_tostr(sv_trimstr(sv_from(string), sv_from(needle)));
 }
 str trimend(str string) {
-    return trimendnchar(string, "\t\r\n ");
+    PROFILE_SCOPE(PROFILE_LEN(string));
+    return sv_tostr(sv_trimend(sv_from(string)));
 }
 str trimendchar(str string, char c) {
-    str ptr = strcopy(string);
-    uint n = strlen(string) - 1;
-    while (ptr[n] == c && n > 0) {
-        ptr[n] = '\0';
-        n--;
-    }
-    return ptr;
+    PROFILE_SCOPE(PROFILE_LEN(string));
+    return sv_tostr(sv_trimendchar(sv_from(string), c));
 }
 str trimendnchar(str string, str params) {
-    str ptr = strcopy(string);
-    uint n = strlen(ptr) - 1;
-    for (uint i = n; i > 0; i--) {
-        int found = 0;
-        for (int j = 0; j < strlen(params); j++) {
-            if (ptr[i] == params[j]) {
-                ptr = trimendchar(ptr, params[j]);
-                found = 1;
-                i = strlen(ptr);
-            }
-        }
-        if (!found)
-            break;
-    }
-    return ptr;
+    PROFILE_SCOPE(PROFILE_LEN(string));
+    return sv_tostr(sv_trimendnchar(sv_from(string), params));
 }
 str trimendstr(str string, str needle) {
-    str ptr = strcopy(string);
-    uint n = strlen(needle);
-    uint end = strlen(ptr);
-    if (n > end)
-        return ptr;
-    while (strncmp(ptr+end-n, needle, n) == 0) {
-        ptr[end-n] = '\0';
-        end = strlen(ptr);
-    }
-    return ptr;
+    PROFILE_SCOPE(PROFILE_LEN(string));
+    return sv_tostr(sv_trimendstr(sv_from(string), sv_from(needle)));
 }
 str trimstart(str string) {
-    return trimstartnchar(string, "\t\r\n ");
+    PROFILE_SCOPE(PROFILE_LEN(string));
+    return sv_tostr(sv_trimstart(sv_from(string)));
 }
 str trimstartchar(str string, char c) {
-    str ptr = strcopy(string);
-    while ((*ptr) == c)
-        ptr++;
-    return ptr;
+    PROFILE_SCOPE(PROFILE_LEN(string));
+    return sv_tostr(sv_trimstartchar(sv_from(string), c));
 }
 str trimstartnchar(str string, str params) {
-    str ptr = strcopy(string);
-    for (uint i = 0; i < strlen(ptr); i++) {
-        int found = 0;
-        for (int j = 0; j < strlen(params); j++) {
-            if (ptr[i] == params[j]) {
-                ptr = trimstartchar(ptr, params[j]);
-                found = 1;
-                j = 0;
-            }
-        }
-        if (!found)
-            break;
-    }
-    return ptr;
+    PROFILE_SCOPE(PROFILE_LEN(string));
+    return sv_tostr(sv_trimstartnchar(sv_from(string), params));
 }
 str trimstartstr(str string, str needle) {
-    str ptr = strcopy(string);
-    uint n = strlen(needle);
-    if (n > strlen(string))
-        return ptr;
-    while(strncmp(ptr, needle, n) == 0)
-        ptr += n;
-    return ptr;
+    PROFILE_SCOPE(PROFILE_LEN(string));
+    return sv_tostr(sv_trimstartstr(sv_from(string), sv_from(needle)));
+}
+str trimcs(str string, const charset* cs) {
+    PROFILE_SCOPE(PROFILE_LEN(string));
+    return sv_tostr(sv_trimcs(sv_from(string), cs));
+}
+str trimendcs(str string, const charset* cs) {
+    PROFILE_SCOPE(PROFILE_LEN(string));
+    return sv_tostr(sv_trimendcs(sv_from(string), cs));
+}
+str trimstartcs(str string, const charset* cs) {
+    PROFILE_SCOPE(PROFILE_LEN(string));
+    return sv_tostr(sv_trimstartcs(sv_from(string), cs));
+}
+ll trim_into(str buf, size_t cap, str string) {
+    PROFILE_SCOPE(PROFILE_LEN(string));
+    return sv_into(buf, cap, sv_trim(sv_from(string)));
+}
+ll trimchar_into(str buf, size_t cap, str string, char c) {
+    PROFILE_SCOPE(PROFILE_LEN(string));
+    return sv_into(buf, cap, sv_trimchar(sv_from(string), c));
+}
+ll trimnchar_into(str buf, size_t cap, str string, str params) {
+    PROFILE_SCOPE(PROFILE_LEN(string));
+    return sv_into(buf, cap, sv_trimnchar(sv_from(string), params));
+}
+ll trimstr_into(str buf, size_t cap, str string, str needle) {
+    PROFILE_SCOPE(PROFILE_LEN(string));
+    return sv_into(buf, cap, sv_trimstr(sv_from(string), sv_from(needle)));
+}
+ll trimend_into(str buf, size_t cap, str string) {
+    PROFILE_SCOPE(PROFILE_LEN(string));
+    return sv_into(buf, cap, sv_trimend(sv_from(string)));
+}
+ll trimendchar_into(str buf, size_t cap, str string, char c) {
+    PROFILE_SCOPE(PROFILE_LEN(string));
+    return sv_into(buf, cap, sv_trimendchar(sv_from(string), c));
+}
+ll trimendnchar_into(str buf, size_t cap, str string, str params) {
+    PROFILE_SCOPE(PROFILE_LEN(string));
+    return sv_into(buf, cap, sv_trimendnchar(sv_from(string), params));
+}
+ll trimendstr_into(str buf, size_t cap, str string, str needle) {
+    PROFILE_SCOPE(PROFILE_LEN(string));
+    return sv_into(buf, cap, sv_trimendstr(sv_from(string), sv_from(needle)));
+}
+ll trimstart_into(str buf, size_t cap, str string) {
+    PROFILE_SCOPE(PROFILE_LEN(string));
+    return sv_into(buf, cap, sv_trimstart(sv_from(string)));
+}
+ll trimstartchar_into(str buf, size_t cap, str string, char c) {
+    PROFILE_SCOPE(PROFILE_LEN(string));
+    return sv_into(buf, cap, sv_trimstartchar(sv_from(string), c));
+}
+ll trimstartnchar_into(str buf, size_t cap, str string, str params) {
+    PROFILE_SCOPE(PROFILE_LEN(string));
+    return sv_into(buf, cap, sv_trimstartnchar(sv_from(string), params));
+}
+ll trimstartstr_into(str buf, size_t cap, str string, str needle) {
+    PROFILE_SCOPE(PROFILE_LEN(string));
+    return sv_into(buf, cap, sv_trimstartstr(sv_from(string), sv_from(needle)));
+}
+ll trimcs_into(str buf, size_t cap, str string, const charset* cs) {
+    PROFILE_SCOPE(PROFILE_LEN(string));
+    return sv_into(buf, cap, sv_trimcs(sv_from(string), cs));
+}
+ll trimendcs_into(str buf, size_t cap, str string, const charset* cs) {
+    PROFILE_SCOPE(PROFILE_LEN(string));
+    return sv_into(buf, cap, sv_trimendcs(sv_from(string), cs));
+}
+ll trimstartcs_into(str buf, size_t cap, str string, const charset* cs) {
+    PROFILE_SCOPE(PROFILE_LEN(string));
+    return sv_into(buf, cap, sv_trimstartcs(sv_from(string), cs));
 }
 str strncopy(str orig, ll n) {
+    PROFILE_SCOPE(n);
     if (orig == NULL) {
         handle_err(NullPtrError, "NULL pointer was trying to be copied\n");
     }
-    if (structs.contains == 0) {
-        structs.strings = malloc(sizeof(vstr)*structs.max_size);
-    } else if (structs.max_size == structs.contains) {
-        structs.max_size *= 2;
-        structs.strings = realloc(structs.strings, sizeof(vstr)*structs.max_size);
-    }
-
-    str ptr = malloc(n + 1);
-    structs.strings[structs.contains] = ptr;
-    structs.contains++;
-    strncpy(ptr, orig, n+1);
+    str ptr = alloc_safe_str(n);
+    strncpy(ptr, orig, n);
     ptr[n] = '\0';
     return ptr;
 }
 str strcopy(str orig) {
+    PROFILE_SCOPE(PROFILE_LEN(orig));
     if (orig == NULL) {
         handle_err(NullPtrError, "NULL pointer was trying to be copied\n");
     }
@@ -156,94 +3621,73 @@ str strcopy(str orig) {
 }
 
 int endswith(str haystack, str needle) {
+    PROFILE_SCOPE(PROFILE_LEN(haystack));
     if (haystack == NULL || needle == NULL)
         return 0;
-    uint a = strlen(haystack);
-    uint b = strlen(needle);
-    if (b > a) return 0;
-    return 0 == strncmp(haystack+a-b, needle, b);
+    return sv_endswith(sv_from(haystack), sv_from(needle));
 }
 int endswithc(str haystack, char needle) {
-    if (haystack == NULL)
+    PROFILE_SCOPE(PROFILE_LEN(haystack));
+    if (haystack == NULL || haystack[0] == '\0')
         return 0;
-    uint a = strlen(haystack);
-    return haystack[a-1] == needle;
+    return haystack[strlen(haystack)-1] == needle;
 }
 int startswith(str haystack, str needle) {
+    PROFILE_SCOPE(PROFILE_LEN(haystack));
     if (haystack == NULL || needle == NULL)
         return 0;
-    uint a = strlen(haystack);
-    uint b = strlen(needle);
-    if (b > a) return 0;
-    return 0 == strncmp(haystack, needle, b);
+    return sv_startswith(sv_from(haystack), sv_from(needle));
 }
 int startswithc(str haystack, char needle) {
+    PROFILE_SCOPE(PROFILE_LEN(haystack));
     if (haystack == NULL)
         return 0;
     return haystack[0] == needle;
 }
 int find(str haystack, str needle) {
-    if (strlen(needle) > strlen(haystack))
-        return -1;
-    if (strlen(needle) == strlen(haystack) && strcmp(haystack, needle) == 0)
-        return 0;
-    uint n = strlen(needle);
-    for (int i = 0; i < strlen(haystack) - n; i++) {
-        if (strncmp(haystack+i, needle, n) == 0)
-            return i;
-    }
-    return -1;
+    PROFILE_SCOPE(PROFILE_LEN(haystack));
+    return (int)sv_find(sv_from(haystack), sv_from(needle));
 }
 
 int rfind(str haystack, str needle) {
-    uint n = strlen(needle);
-    uint a = strlen(haystack);
-    if (n > a)
-        return -1;
-    if (n == a && strcmp(needle, haystack) == 0)
-        return 0;
-    for (int i = a-n; i > n; i--) {
-        if (strncmp(haystack+i, needle, n) == 0)
-            return i;
-    }
-    return -1;
+    PROFILE_SCOPE(PROFILE_LEN(haystack));
+    return (int)sv_rfind(sv_from(haystack), sv_from(needle));
 }
 
 int findc(str haystack, char needle) {
-    for (int i = 0; i < strlen(haystack); i++)
-        if (haystack[i] == needle)
-            return i;
-    return -1;
+    PROFILE_SCOPE(PROFILE_LEN(haystack));
+    return (int)sv_findc(sv_from(haystack), needle);
 }
 
 int findnc(str haystack, str params) {
-    for (int i = 0; i < strlen(haystack); i++)
-        for (int j = 0; j < strlen(params); j++)
-            if (haystack[i] == params[j])
-                return i;
-    return -1;
+    return (int)sv_findnc(sv_from(haystack), params);
 }
 
 int rfindc(str haystack, char needle) {
-    for (int i = strlen(haystack) - 1; i >= 0; i--)
-        if (haystack[i] == needle)
-            return i;
-    return -1;
+    PROFILE_SCOPE(PROFILE_LEN(haystack));
+    return (int)sv_rfindc(sv_from(haystack), needle);
 }
 int rfindnc(str haystack, str params) {
-    for (int i = strlen(haystack) - 1; i >= 0; i--)
-        for (int j = 0; j < strlen(params); j++)
-            if (haystack[i] == params[j])
-                return i;
-    return -1;
+    return (int)sv_rfindnc(sv_from(haystack), params);
+}
+int findcs(str haystack, const charset* cs) {
+    PROFILE_SCOPE(PROFILE_LEN(haystack));
+    return (int)sv_findcs(sv_from(haystack), cs);
+}
+int rfindcs(str haystack, const charset* cs) {
+    PROFILE_SCOPE(PROFILE_LEN(haystack));
+    return (int)sv_rfindcs(sv_from(haystack), cs);
 }
 int contains(str haystack, str needle) {
+    PROFILE_SCOPE(PROFILE_LEN(haystack));
     return find(haystack, needle) != -1;
 }
 int containsc(str haystack, char needle) {
+    PROFILE_SCOPE(PROFILE_LEN(haystack));
     return findc(haystack, needle) != -1;
 }
 str sum(str first, str second) {
+    PROFILE_SCOPE(PROFILE_LEN(first) + PROFILE_LEN(second));
     if (first == NULL || second == NULL) {
         handle_err(NullPtrError, "NULL pointer was trying to be added\n");
     }
@@ -253,278 +3697,1193 @@ str sum(str first, str second) {
     return ptr;
 }
 
-str sub(str haystack, char needle) {
-    str ptr = strcopy(haystack);
-    int i = 0;
-    uint n = strlen(ptr);
-    while (ptr[i] != '\0') {
-        if (ptr[i] == needle) {
-            memmove(ptr+i, ptr+i+1, n-i);
-        } else { i++; }
-    }
-    return ptr;
+ll compact_into(str buf, size_t cap, str string, const charset* cs, int runs) {
+    if (string == NULL) {
+        handle_err(NullPtrError, "NULL pointer was trying to be copied\n");
+    }
+    size_t len = strlen(string), n = 0;
+    if (cap > len) {
+        n = KERNEL(compactcs)(buf, string, len, cs, runs, 0);
+        buf[n] = '\0';
+        return n;
+    }
+    // The output might not fit: compact a block at a time and copy what fits
+    char block[COMPACT_BLOCK];
+    int prev = 0;
+    for (size_t i = 0; i < len; i += COMPACT_BLOCK) {
+        size_t m = len - i < COMPACT_BLOCK ? len - i : COMPACT_BLOCK;
+        n = put_clamped(buf, cap > 0 ? cap-1 : 0, n, block, KERNEL(compactcs)(block, string+i, m, cs, runs, prev));
+        prev = CS_HAS(cs, string[i+m-1]);
+    }
+    if (cap > 0)
+        buf[n < cap ? n : cap-1] = '\0';
+    return n;
+}
+
+str sub(str haystack, char needle) {
+    PROFILE_SCOPE(PROFILE_LEN(haystack));
+    if (haystack == NULL) {
+        handle_err(NullPtrError, "NULL pointer was trying to be copied\n");
+    }
+    size_t len = strlen(haystack);
+    str ptr = alloc_safe_str(len);
+    sub_into(ptr, len+1, haystack, needle);
+    return ptr;
+}
+ll sub_into(str buf, size_t cap, str haystack, char needle) {
+    PROFILE_SCOPE(PROFILE_LEN(haystack));
+    char params[2] = { needle, '\0' };
+    charset cs = charset_from(params);
+    return compact_into(buf, cap, haystack, &cs, 0);
+}
+str removenc(str string, str params) {
+    PROFILE_SCOPE(PROFILE_LEN(string));
+    charset cs = charset_from(params);
+    return removecs(string, &cs);
+}
+str removecs(str string, const charset* cs) {
+    PROFILE_SCOPE(PROFILE_LEN(string));
+    if (string == NULL) {
+        handle_err(NullPtrError, "NULL pointer was trying to be copied\n");
+    }
+    size_t len = strlen(string);
+    str ptr = alloc_safe_str(len);
+    compact_into(ptr, len+1, string, cs, 0);
+    return ptr;
+}
+ll removecs_into(str buf, size_t cap, str string, const charset* cs) {
+    PROFILE_SCOPE(PROFILE_LEN(string));
+    return compact_into(buf, cap, string, cs, 0);
+}
+
+str append(str first, char second) {
+    PROFILE_SCOPE(PROFILE_LEN(first));
+    if (first == NULL) {
+        handle_err(NullPtrError, "NULL pointer was trying to be added\n");
+    }
+    str ptr = alloc_safe_str(strlen(first)+1);
+    strncpy(ptr, first, strlen(first)+1);
+    uint n = strlen(ptr);
+    ptr[n] = second;
+    ptr[n+1] = '\0';
+    return ptr;
+}
+// Returns 0 if the buffer couldn't grow, sb is left as it was then
+int sb_grow(strbuilder* sb, size_t needed) {
+    size_t cap = sb->cap ? sb->cap : 16;
+    while (cap < needed)
+        cap *= 2;
+    PROFILE_ALLOC(cap);
+    // Room for the header is kept in front of the buffer so that sb_finish() doesn't have to copy
+    alloc_header* header;
+    if (sb->arena != NULL) {
+        // Arena memory can't be resized, the old buffer stays behind until the arena is reset (at most as much as the final one)
+        header = arena_alloc(sb->arena, sizeof(alloc_header) + cap);
+        if (header == NULL)
+            return 0;
+        if (sb->buf != NULL)
+            memcpy(header + 1, sb->buf, sb->len + 1);
+    } else {
+        header = realloc(sb->buf != NULL ? HEADER(sb->buf) : NULL, sizeof(alloc_header) + cap);
+        if (header == NULL) {
+            handle_err(NullPtrError, "Memory %lu bytes couldn't be alloc'd\n", (ulint)(cap));
+            return 0;
+        }
+    }
+    sb->buf = (str)(header + 1);
+    sb->cap = cap;
+    return 1;
+}
+
+void sb_init(strbuilder* sb, size_t capacity) {
+    if (sb == NULL) {
+        handle_err(NullPtrError, "NULL pointer was trying to be initialized\n");
+    }
+    sb->buf = NULL;
+    sb->len = 0;
+    sb->cap = 0;
+    sb->arena = ARENA;
+    if (sb_grow(sb, capacity + 1))
+        sb->buf[0] = '\0';
+}
+void sb_reserve(strbuilder* sb, size_t additional) {
+    if (sb->len + additional + 1 > sb->cap)
+        sb_grow(sb, sb->len + additional + 1);
+}
+void sb_appendn(strbuilder* sb, const char* string, size_t len) {
+    PROFILE_SCOPE(len);
+    if (string == NULL) {
+        handle_err(NullPtrError, "NULL pointer was trying to be added\n");
+    }
+    // A slice of the builder itself has to be found again after sb_reserve() moved the buffer
+    if (sb->buf != NULL && string >= sb->buf && string < sb->buf + sb->cap) {
+        size_t offset = string - sb->buf;
+        sb_reserve(sb, len);
+        string = sb->buf + offset;
+    } else {
+        sb_reserve(sb, len);
+    }
+    if (sb->len + len + 1 > sb->cap)
+        return;
+    memcpy(sb->buf + sb->len, string, len);
+    sb->len += len;
+    sb->buf[sb->len] = '\0';
+}
+void sb_appendc(strbuilder* sb, char c) {
+    PROFILE_SCOPE(1);
+    if (sb->len + 2 > sb->cap && !sb_grow(sb, sb->len + 2))
+        return;
+    sb->buf[sb->len++] = c;
+    sb->buf[sb->len] = '\0';
+}
+void sb_appends(strbuilder* sb, const char* string) {
+    PROFILE_SCOPE(PROFILE_LEN(string));
+    if (string == NULL) {
+        handle_err(NullPtrError, "NULL pointer was trying to be added\n");
+    }
+    sb_appendn(sb, string, strlen(string));
+}
+void sb_appendsv(strbuilder* sb, strview view) {
+    PROFILE_SCOPE(view.len);
+    sb_appendn(sb, view.ptr, view.len);
+}
+void sb_appendf(strbuilder* sb, const char* format, ...) {
+    PROFILE_SCOPE(0);
+    va_list args, copy;
+    va_start(args, format);
+    va_copy(copy, args);
+    int n = vsnprintf(sb->buf + sb->len, sb->cap - sb->len, format, args);
+    va_end(args);
+    if (n >= 0 && (size_t)n >= sb->cap - sb->len) {
+        sb_reserve(sb, n);
+        if ((size_t)n < sb->cap - sb->len)
+            vsnprintf(sb->buf + sb->len, sb->cap - sb->len, format, copy);
+        else
+            n = 0;
+    }
+    va_end(copy);
+    if (n > 0)
+        sb->len += n;
+    if (sb->buf != NULL)
+        sb->buf[sb->len] = '\0';
+}
+strview sb_view(const strbuilder* sb) {
+    return sv_fromn(sb->buf, sb->len);
+}
+void sb_clear(strbuilder* sb) {
+    sb->len = 0;
+    if (sb->buf != NULL)
+        sb->buf[0] = '\0';
+}
+str sb_finish(strbuilder* sb) {
+    str ptr = sb->buf;
+    if (ptr == NULL)
+        return NULL;
+    HEADER(ptr)->flags = sb->arena != NULL ? ALLOC_ARENA : 0;
+    if (sb->arena == NULL)
+        register_string(ptr);
+    sb->buf = NULL;
+    sb->len = 0;
+    sb->cap = 0;
+    return ptr;
+}
+void sb_free(strbuilder* sb) {
+    if (sb->arena == NULL && sb->buf != NULL)
+        free(HEADER(sb->buf));
+    sb->buf = NULL;
+    sb->len = 0;
+    sb->cap = 0;
+}
+
+int count(str haystack, str needle) {
+    PROFILE_SCOPE(PROFILE_LEN(haystack));
+    return (int)sv_count(sv_from(haystack), sv_from(needle));
+}
+int countnc(str haystack, str params) {
+    PROFILE_SCOPE(PROFILE_LEN(haystack));
+    charset cs = charset_from(params);
+    return countcs(haystack, &cs);
+}
+int countcs(str haystack, const charset* cs) {
+    PROFILE_SCOPE(PROFILE_LEN(haystack));
+    return (int)sv_countcs(sv_from(haystack), cs);
+}
+int countc(str haystack, char c) {
+    PROFILE_SCOPE(PROFILE_LEN(haystack));
+    return (int)sv_countc(sv_from(haystack), c);
+}
+int countstr(str haystack , str needle) {
+    return count(haystack, needle);
+}
+
+vstr alloc_vect(int n) {
+    size_t size = sizeof(str)*n;
+    PROFILE_ALLOC(size);
+    alloc_header* header;
+    if (ARENA != NULL) {
+        header = arena_alloc(ARENA, sizeof(alloc_header) + size);
+        if (header == NULL)
+            return NULL;
+        header->flags = ALLOC_ARENA;
+    } else {
+        header = malloc(sizeof(alloc_header) + size);
+        if (header == NULL) {
+            handle_err(NullPtrError, "Memory %lu bytes couldn't be alloc'd\n", (ulint)(size));
+            return NULL;
+        }
+        header->flags = 0;
+    }
+    header->count = n;
+    vstr ret = (vstr)(header + 1);
+    if (ARENA == NULL)
+        register_vect(ret);
+    return ret;
+}
+
+unsigned long long hash_bytes(const char* ptr, size_t len) {
+    // Multiply-xorshift over 8 bytes at a time, then the murmur3 finalizer so the low bits used for the slot are well mixed
+    unsigned long long h = 0x9E3779B97F4A7C15ULL ^ (len * 0xC2B2AE3D27D4EB4FULL);
+    unsigned long long word;
+    size_t i = 0;
+    for (; i + 8 <= len; i += 8) {
+        memcpy(&word, ptr + i, 8);
+        h = (h ^ word) * 0xBF58476D1CE4E5B9ULL;
+        h ^= h >> 31;
+    }
+    if (i < len) {
+        word = 0;
+        memcpy(&word, ptr + i, len - i);
+        h = (h ^ word) * 0xBF58476D1CE4E5B9ULL;
+        h ^= h >> 31;
+    }
+    h ^= h >> 33;
+    h *= 0xFF51AFD7ED558CCDULL;
+    h ^= h >> 33;
+    h *= 0xC4CEB9FE1A85EC53ULL;
+    h ^= h >> 33;
+    return h;
+}
+
+// Returns 0 if the bigger table couldn't be allocated, the old one is kept then
+int intern_grow(void) {
+    size_t cap = INTERNED.cap == 0 ? INTERN_SLOTS : INTERNED.cap * 2;
+    intern_slot* slots = (intern_slot*)safe_alloc_generic(sizeof(intern_slot), cap);
+    if (slots == NULL)
+        return 0;
+    for (size_t i = 0; i < INTERNED.cap; i++) {
+        if (INTERNED.slots[i].ptr == NULL)
+            continue;
+        size_t j = (size_t)INTERNED.slots[i].hash & (cap - 1);
+        while (slots[j].ptr != NULL)
+            j = (j + 1) & (cap - 1);
+        slots[j] = INTERNED.slots[i];
+    }
+    free(INTERNED.slots);
+    INTERNED.slots = slots;
+    INTERNED.cap = cap;
+    return 1;
+}
+
+str sv_intern(strview view) {
+    PROFILE_SCOPE(view.len);
+    if (view.ptr == NULL) {
+        handle_err(NullPtrError, "NULL pointer was trying to be interned\n");
+        return NULL;
+    }
+    // Kept at most half full so probe sequences stay short
+    if (2 * (INTERNED.count + 1) > INTERNED.cap && !intern_grow())
+        return NULL;
+    unsigned long long h = hash_bytes(view.ptr, view.len);
+    size_t i = (size_t)h & (INTERNED.cap - 1);
+    for (; INTERNED.slots[i].ptr != NULL; i = (i + 1) & (INTERNED.cap - 1)) {
+        intern_slot* slot = &INTERNED.slots[i];
+        if (slot->hash == h && slot->len == view.len && memcmp(slot->ptr, view.ptr, view.len) == 0)
+            return slot->ptr;
+    }
+    if (INTERNED.arena == NULL) {
+        arm_thread_exit();
+        INTERNED.arena = create_arena_stringutils(0);
+        if (INTERNED.arena == NULL)
+            return NULL;
+    }
+    PROFILE_ALLOC(view.len+1);
+    alloc_header* header = arena_alloc(INTERNED.arena, sizeof(alloc_header) + view.len+1);
+    if (header == NULL)
+        return NULL;
+    header->flags = ALLOC_INTERNED;
+    header->count = 0;
+    str ptr = (str)(header + 1);
+    memcpy(ptr, view.ptr, view.len);
+    ptr[view.len] = '\0';
+    INTERNED.slots[i].hash = h;
+    INTERNED.slots[i].len = view.len;
+    INTERNED.slots[i].ptr = ptr;
+    INTERNED.count++;
+    return ptr;
+}
+str intern(str string) {
+    PROFILE_SCOPE(PROFILE_LEN(string));
+    if (string == NULL) {
+        handle_err(NullPtrError, "NULL pointer was trying to be interned\n");
+    }
+    return sv_intern(sv_from(string));
+}
+int is_interned(const char* string) {
+    return string != NULL && (HEADER(string)->flags & ALLOC_INTERNED) != 0;
+}
+size_t interned_count_stringutils() {
+    return INTERNED.count;
+}
+void intern_on_split_stringutils(int enabled) {
+    INTERN_ON_SPLIT = enabled;
+}
+void clear_interned_stringutils() {
+    destroy_arena_stringutils(INTERNED.arena);
+    free(INTERNED.slots);
+    INTERNED.arena = NULL;
+    INTERNED.slots = NULL;
+    INTERNED.cap = 0;
+    INTERNED.count = 0;
+}
+
+token_histogram* histogram_create(size_t max_tokens) {
+    PROFILE_SCOPE(0);
+    token_histogram* h = (token_histogram*)safe_alloc_generic(sizeof(token_histogram), 1);
+    if (h == NULL)
+        return NULL;
+    h->max = max_tokens;
+    h->cap = max_tokens > 0 ? max_tokens : HISTOGRAM_SLOTS / 2;
+    h->slot_cap = HISTOGRAM_SLOTS;
+    while (h->slot_cap < 2 * h->cap)
+        h->slot_cap *= 2;
+    h->entries = (token_count*)safe_alloc_generic(sizeof(token_count), h->cap);
+    h->hashes = (unsigned long long*)safe_alloc_generic(sizeof(unsigned long long), h->cap);
+    h->rooms = (size_t*)safe_alloc_generic(sizeof(size_t), h->cap);
+    h->slots = (size_t*)safe_alloc_generic(sizeof(size_t), h->slot_cap);
+    h->arena = create_arena_stringutils(0);
+    if (h->entries == NULL || h->hashes == NULL || h->rooms == NULL || h->slots == NULL || h->arena == NULL) {
+        histogram_free(h);
+        return NULL;
+    }
+    return h;
+}
+
+size_t histogram_slot(const token_histogram* h, unsigned long long hash, strview token) {
+    size_t i = (size_t)hash & (h->slot_cap - 1);
+    for (; h->slots[i] != 0; i = (i + 1) & (h->slot_cap - 1)) {
+        size_t e = h->slots[i] - 1;
+        if (h->hashes[e] == hash && h->entries[e].token.len == token.len && memcmp(h->entries[e].token.ptr, token.ptr, token.len) == 0)
+            break;
+    }
+    return i;
+}
+
+// Returns 0 if the tables couldn't grow, the histogram keeps working with the old ones then
+int histogram_grow(token_histogram* h) {
+    size_t cap = h->cap * 2;
+    size_t* slots = (size_t*)safe_alloc_generic(sizeof(size_t), h->slot_cap * 2);
+    if (slots == NULL)
+        return 0;
+    // Each array that did move is kept even if a later one fails, they only hold more room than needed
+    token_count* entries = realloc(h->entries, sizeof(token_count) * cap);
+    if (entries != NULL)
+        h->entries = entries;
+    unsigned long long* hashes = entries != NULL ? realloc(h->hashes, sizeof(unsigned long long) * cap) : NULL;
+    if (hashes != NULL)
+        h->hashes = hashes;
+    size_t* rooms = hashes != NULL ? realloc(h->rooms, sizeof(size_t) * cap) : NULL;
+    if (rooms == NULL) {
+        handle_err(NullPtrError, "Memory %lu bytes couldn't be alloc'd\n", (ulint)(sizeof(token_count) * cap));
+        free(slots);
+        return 0;
+    }
+    h->rooms = rooms;
+    h->cap = cap;
+    free(h->slots);
+    h->slot_cap *= 2;
+    h->slots = slots;
+    for (size_t e = 0; e < h->count; e++) {
+        size_t i = (size_t)h->hashes[e] & (h->slot_cap - 1);
+        while (h->slots[i] != 0)
+            i = (i + 1) & (h->slot_cap - 1);
+        h->slots[i] = e + 1;
+    }
+    return 1;
+}
+
+void histogram_unlink(token_histogram* h, size_t e) {
+    size_t i = (size_t)h->hashes[e] & (h->slot_cap - 1);
+    while (h->slots[i] != e + 1)
+        i = (i + 1) & (h->slot_cap - 1);
+    // Backward shift deletion, entries further along the probe sequence fill the hole so lookups never need tombstones
+    for (size_t j = (i + 1) & (h->slot_cap - 1); h->slots[j] != 0; j = (j + 1) & (h->slot_cap - 1)) {
+        size_t home = (size_t)h->hashes[h->slots[j] - 1] & (h->slot_cap - 1);
+        if (((j - home) & (h->slot_cap - 1)) >= ((j - i) & (h->slot_cap - 1))) {
+            h->slots[i] = h->slots[j];
+            i = j;
+        }
+    }
+    h->slots[i] = 0;
+}
+
+// Copies the token in the room of entry e, returns 0 and leaves the entry alone if a bigger room couldn't be allocated
+int histogram_store(token_histogram* h, size_t e, strview token) {
+    if (h->rooms[e] < token.len + 1) {
+        // With a cap, slots get reused by other tokens: rounding up keeps the arena from growing with every eviction
+        size_t room = token.len + 1;
+        if (h->max > 0) {
+            room = 16;
+            while (room < token.len + 1)
+                room *= 2;
+        }
+        str grown = arena_alloc(h->arena, room);
+        if (grown == NULL)
+            return 0;
+        h->entries[e].token.ptr = grown;
+        h->rooms[e] = room;
+    }
+    str ptr = (str)h->entries[e].token.ptr;
+    memcpy(ptr, token.ptr, token.len);
+    ptr[token.len] = '\0';
+    h->entries[e].token.len = token.len;
+    return 1;
+}
+
+int histogram_heap_less(const token_histogram* h, size_t a, size_t b) {
+    return h->entries[h->heap[a]].count < h->entries[h->heap[b]].count;
+}
+
+void histogram_sift_down(token_histogram* h, size_t i) {
+    for (;;) {
+        size_t min = i, l = 2 * i + 1, r = 2 * i + 2;
+        if (l < h->count && histogram_heap_less(h, l, min))
+            min = l;
+        if (r < h->count && histogram_heap_less(h, r, min))
+            min = r;
+        if (min == i)
+            return;
+        size_t tmp = h->heap[i];
+        h->heap[i] = h->heap[min];
+        h->heap[min] = tmp;
+        h->heap_pos[h->heap[i]] = i;
+        h->heap_pos[h->heap[min]] = min;
+        i = min;
+    }
+}
+
+void histogram_add_n(token_histogram* h, strview token, unsigned long long n) {
+    if (token.ptr == NULL) {
+        handle_err(NullPtrError, "NULL pointer was trying to be counted\n");
+        return;
+    }
+    unsigned long long hash = hash_bytes(token.ptr, token.len);
+    size_t i = histogram_slot(h, hash, token);
+    size_t e;
+    if (h->slots[i] != 0) {
+        e = h->slots[i] - 1;
+        h->total += n;
+        h->entries[e].count += n;
+        if (h->heap != NULL)
+            histogram_sift_down(h, h->heap_pos[e]);
+        return;
+    }
+    // A token that can't be stored isn't counted at all, the error was already raised
+    if (h->max == 0 || h->count < h->max) {
+        if (h->count == h->cap) {
+            if (!histogram_grow(h))
+                return;
+            i = histogram_slot(h, hash, token);
+        }
+        e = h->count;
+        h->rooms[e] = 0;
+        if (!histogram_store(h, e, token))
+            return;
+        h->count++;
+        h->entries[e].count = n;
+        h->entries[e].error = 0;
+    } else {
+        // Space-Saving: the least counted token makes room and the newcomer inherits its count as the error bound
+        if (h->heap == NULL) {
+            h->heap = (size_t*)safe_alloc_generic(sizeof(size_t), h->count);
+            h->heap_pos = (size_t*)safe_alloc_generic(sizeof(size_t), h->count);
+            if (h->heap == NULL || h->heap_pos == NULL) {
+                free(h->heap);
+                free(h->heap_pos);
+                h->heap = h->heap_pos = NULL;
+                return;
+            }
+            for (size_t j = 0; j < h->count; j++) {
+                h->heap[j] = j;
+                h->heap_pos[j] = j;
+            }
+            for (size_t j = h->count / 2; j-- > 0;)
+                histogram_sift_down(h, j);
+        }
+        e = h->heap[0];
+        // The slot of the evicted token is only found through its hash, so its text can be overwritten first
+        if (!histogram_store(h, e, token))
+            return;
+        histogram_unlink(h, e);
+        i = histogram_slot(h, hash, token);
+        h->evicted++;
+        h->entries[e].error = h->entries[e].count;
+        h->entries[e].count += n;
+    }
+    h->total += n;
+    h->hashes[e] = hash;
+    h->slots[i] = e + 1;
+    if (h->heap != NULL)
+        histogram_sift_down(h, h->heap_pos[e]);
+}
+
+void histogram_add(token_histogram* h, strview token) {
+    PROFILE_SCOPE(token.len);
+    histogram_add_n(h, token, 1);
 }
 
-str append(str first, char second) {
-    if (first == NULL) {
-        handle_err(NullPtrError, "NULL pointer was trying to be added\n");
+void histogram_count(token_histogram* h, strview text, token_separator sep) {
+    PROFILE_SCOPE(text.len);
+    if (text.ptr == NULL) {
+        handle_err(NullPtrError, "NULL pointer was trying to be counted\n");
+    }
+    compiled_needle cn;
+    if (sep.kind == SepString)
+        needle_init(&cn, sep.needle.ptr, sep.needle.len, NEEDLE_FORWARD);
+    size_t seplen;
+    for (;;) {
+        ll i = sep_find(&sep, &cn, text.ptr, text.len, &seplen);
+        size_t len = i == -1 ? text.len : (size_t)i;
+        if (len > 0 || sep.kind != SepWhitespace)
+            histogram_add_n(h, sv_fromn(text.ptr, len), 1);
+        if (i == -1)
+            return;
+        text.ptr += i + seplen;
+        text.len -= i + seplen;
     }
-    str ptr = alloc_safe_str(strlen(first)+1);
-    strncpy(ptr, first, strlen(first)+1);
-    uint n = strlen(ptr);
-    ptr[n] = second;
-    ptr[n+1] = '\0';
-    return ptr;
 }
-int count(str haystack, str needle) {
-    int n = 0;
-    uint a = strlen(haystack);
-    uint b = strlen(needle);
-    if (b > a || (b == a && strcmp(haystack, needle) != 0))
-        return 0;
-    if (b == a && strcmp(haystack, needle) == 0)
-        return 1;
-    for (int i = 0; i <= a-b; i++) {
-        if (strncmp(haystack+i, needle, b) == 0)
-            n++;
+
+void histogram_drain(token_histogram* h, stream_tokenizer* tok) {
+    strview token;
+    size_t len = 0;
+    int pending = 0;
+    while (tokenizer_next(tok, &token)) {
+        // Pieces of a token longer than the read buffer are glued back together before being counted
+        if (tok->truncated || pending) {
+            if (len + token.len > h->scratch_cap) {
+                h->scratch_cap = 2 * (len + token.len);
+                h->scratch = realloc(h->scratch, h->scratch_cap);
+                if (h->scratch == NULL) {
+                    handle_err(NullPtrError, "Memory %lu bytes couldn't be alloc'd\n", (ulint)(h->scratch_cap));
+                }
+            }
+            memcpy(h->scratch + len, token.ptr, token.len);
+            len += token.len;
+            pending = tok->truncated;
+            if (pending)
+                continue;
+            token = sv_fromn(h->scratch, len);
+            len = 0;
+        }
+        histogram_add_n(h, token, 1);
     }
-    return n;
+    tokenizer_close(tok);
 }
-int countnc(str haystack, str params) {
-    int n = 0;
-    for (int i = 0; i < strlen(params); i++)
-        n += countc(haystack, params[i]);
-    return n;
+
+void histogram_count_file(token_histogram* h, FILE* file, token_separator sep) {
+    PROFILE_SCOPE(0);
+    histogram_drain(h, tokenizer_open_file(file, sep, 0));
 }
-int countc(str haystack, char c) {
-     int n = 0;
-     for (int i = 0; i < strlen(haystack); i++)
-         if (haystack[i] == c)
-             n++;
-     return n;
+
+void histogram_count_fd(token_histogram* h, int fd, token_separator sep) {
+    PROFILE_SCOPE(0);
+    histogram_drain(h, tokenizer_open_fd(fd, sep, 0));
 }
-int countstr(str haystack , str needle) {
-    int n = 0;
-    uint a = strlen(haystack);
-    uint b = strlen(needle);
-    if (b > a)
-        return 0;
-    if (a == b)
-        return strcmp(haystack, needle) == 0;
-    for (int i = 0; i <= a-b; i++) {
-        if (strncmp(haystack+i, needle, b) == 0)
-            n++;
+
+unsigned long long histogram_get(const token_histogram* h, strview token) {
+    PROFILE_SCOPE(token.len);
+    size_t i = histogram_slot(h, hash_bytes(token.ptr, token.len), token);
+    return h->slots[i] != 0 ? h->entries[h->slots[i] - 1].count : 0;
+}
+
+int token_count_less(const token_count* a, const token_count* b) {
+    // Lower count first, ties broken by the bytes of the token so the order doesn't depend on hashing
+    if (a->count != b->count)
+        return a->count < b->count;
+    size_t len = a->token.len < b->token.len ? a->token.len : b->token.len;
+    int cmp = memcmp(a->token.ptr, b->token.ptr, len);
+    return cmp != 0 ? cmp > 0 : a->token.len > b->token.len;
+}
+
+void token_count_sift_down(token_count* heap, size_t size, size_t i) {
+    for (;;) {
+        size_t min = i, l = 2 * i + 1, r = 2 * i + 2;
+        if (l < size && token_count_less(&heap[l], &heap[min]))
+            min = l;
+        if (r < size && token_count_less(&heap[r], &heap[min]))
+            min = r;
+        if (min == i)
+            return;
+        token_count tmp = heap[i];
+        heap[i] = heap[min];
+        heap[min] = tmp;
+        i = min;
     }
-    return n;
 }
 
-vstr alloc_vect(int size) {
-    vstr ret = malloc(size);
-    if (vstructs.contains == 0) {
-        vstructs.vectors = malloc(sizeof(vstr*)*vstructs.max_size);
-    } else if (vstructs.max_size == vstructs.contains) {
-        vstructs.max_size *= 2;
-        vstructs.vectors = realloc(vstructs.vectors, sizeof(vstr*)*vstructs.max_size);
+size_t histogram_top(const token_histogram* h, token_count* out, size_t k) {
+    PROFILE_SCOPE(0);
+    if (k > h->count)
+        k = h->count;
+    if (k == 0)
+        return 0;
+    // Min-heap of the k best seen so far, then heapsort it so the most frequent token ends up first
+    memcpy(out, h->entries, sizeof(token_count) * k);
+    for (size_t i = k / 2; i-- > 0;)
+        token_count_sift_down(out, k, i);
+    for (size_t e = k; e < h->count; e++) {
+        if (token_count_less(&out[0], &h->entries[e])) {
+            out[0] = h->entries[e];
+            token_count_sift_down(out, k, 0);
+        }
     }
-    vstructs.vectors[vstructs.contains] = ret;
-    vstructs.contains++;
-    return ret;
+    for (size_t size = k; size > 1; size--) {
+        token_count tmp = out[0];
+        out[0] = out[size - 1];
+        out[size - 1] = tmp;
+        token_count_sift_down(out, size - 1, 0);
+    }
+    return k;
+}
+
+void histogram_free(token_histogram* h) {
+    if (h == NULL)
+        return;
+    destroy_arena_stringutils(h->arena);
+    free(h->entries);
+    free(h->hashes);
+    free(h->rooms);
+    free(h->slots);
+    free(h->heap);
+    free(h->heap_pos);
+    free(h->scratch);
+    free(h);
+}
+
+str split_token(strview token) {
+    return INTERN_ON_SPLIT ? sv_intern(token) : sv_tostr(token);
 }
 
 vstr split(str string, tp(int, size)) {
-    int n = 0;
-    vstr vect = splitnc(string, "\t\n\r ", size);
-    for (int i = 0; i < p(size); i++) {
-        if (strlen(vect[i]) != 0)
-            n++;
-    }
-    vstr retv = alloc_vect(sizeof(str)*n);
-    for (int i = 0, j = 0; i < p(size); i++) {
-        if (strlen(vect[i]) != 0)
-            retv[j++] = strcopy(vect[i]);
+    PROFILE_SCOPE(PROFILE_LEN(string));
+    if (string == NULL) {
+        handle_err(NullPtrError, "NULL pointer was trying to be split\n");
     }
+    strview rest = sv_from(string), token;
+    int n = 0;
+    while (sv_split_next(&rest, &token))
+        n++;
+    vstr vect = alloc_vect(n);
+    rest = sv_from(string);
+    for (int i = 0; sv_split_next(&rest, &token); i++)
+        vect[i] = split_token(token);
     p(size) = n;
-    return retv;
+    return vect;
 }
 vstr splitc(str string, char c, tp(int, size)) {
-    p(size) = countc(string, c)+1;
-    if (p(size) == 0)
-        return NULL;
-    vstr vect = alloc_vect(sizeof(str)*(p(size)));
-    int a = findc(string, c);
-    vect[0] = strncopy(string, a);
-    vect[0][a] = '\0';
-    int b = a + findc(string+a+1, c);
-    int i = 1;
-    while (a != -1 && b != -1 && i < p(size)) {
-        if ((a-1) >= b) {
-            vect[i] = strncopy(string + a + 1, strlen(string) - a);
-            break;
-        }
-        vect[i] = strncopy(string+a+1, b-a);
-        vect[i][b-a] = '\0';
-        i++;
-        a = b+1;
-        b = a + findc(string+a+1, c);
+    PROFILE_SCOPE(PROFILE_LEN(string));
+    if (string == NULL) {
+        handle_err(NullPtrError, "NULL pointer was trying to be split\n");
     }
+    strview rest = sv_from(string), token;
+    int n = (int)sv_countc(rest, c) + 1;
+    vstr vect = alloc_vect(n);
+    for (int i = 0; sv_splitc_next(&rest, c, &token); i++)
+        vect[i] = split_token(token);
+    p(size) = n;
     return vect;
 }
 vstr splitnc(str string, str params, tp(int, size)) {
+    PROFILE_SCOPE(PROFILE_LEN(string));
     if (strlen(params) == 0) {
         handle_err(EmptySeparator, "Split attempt with empty separator\n");
     }
-    int n = countnc(string, params) + 1;
-    if (n == 0)
-        return NULL;
-    vstr vect = alloc_vect(sizeof(str)*n);
-    int a = findnc(string, params);
-    if (a == -1) {
-        p(size) = n;
-        vect[0] = strcopy(string);
-        return vect;
-    }
-    vect[0] = strncopy(string, a);
-    vect[0][a] = '\0';
-    int b = a + findnc(string+a+1, params);
-    int i = 1;
-    while (a != -1 && b != -1 && i < n) {
-        if ((a-1) >= b) {
-            vect[i] = strncopy(string + a + 1, strlen(string) - a);
-            break;
-        }
-        vect[i] = strncopy(string+a+1, b-a);
-        vect[i][b-a] = '\0';
-        i++;
-        a = b+1;
-        b = a + findnc(string+a+1, params);
+    charset cs = charset_from(params);
+    return splitcs(string, &cs, size);
+}
+vstr splitcs(str string, const charset* cs, tp(int, size)) {
+    PROFILE_SCOPE(PROFILE_LEN(string));
+    if (string == NULL) {
+        handle_err(NullPtrError, "NULL pointer was trying to be split\n");
     }
+    strview rest = sv_from(string), token;
+    int n = (int)sv_countcs(rest, cs) + 1;
+    vstr vect = alloc_vect(n);
+    for (int i = 0; sv_splitcs_next(&rest, cs, &token); i++)
+        vect[i] = split_token(token);
     p(size) = n;
     return vect;
 }
 vstr splitstr(str string, str needle, tp(int, size)) {
+    PROFILE_SCOPE(PROFILE_LEN(string));
     if (strlen(needle) == 0) {
         handle_err(EmptySeparator, "Split attempt with empty separator\n");
     }
-    int n = countstr(string, needle)+1;
-    int l = strlen(needle);
-    if (n == 1) {
-        vstr vect = alloc_vect(sizeof(str)*n);
-        vect[0] = calloc(1, 1);
-        p(size) = n;
-        return vect;
-    }
-    vstr vect = alloc_vect(sizeof(str)*n);
-    int a = find(string, needle);
-    vect[0] = strncopy(string, a);
-    vect[0][a] = '\0';
-    int b = a + find(string+a+l, needle);
-    if (b == -1 && n == 2) {
-        vect[1] = alloc_safe_str(1);
-        vect[1][0] = '\0';
-        p(size) = n;
-        return vect;
-    }
-    int i = 1;
-    while (a != -1 && b != -1 && i < n) {
-        if ((a-1) >= b) {
-            vect[i] = strncopy(string + a + l, strlen(string) - a - l);
-            break;
-        }
-        vect[i] = strncopy(string+a+l, b-a);
-        vect[i][b-a] = '\0';
-        i++;
-        a = b+l;
-        b = a + find(string+a+l, needle);
+    if (string == NULL) {
+        handle_err(NullPtrError, "NULL pointer was trying to be split\n");
     }
+    strview rest = sv_from(string), sep = sv_from(needle), token;
+    int n = 0;
+    while (sv_splitstr_next(&rest, sep, &token))
+        n++;
+    vstr vect = alloc_vect(n);
+    rest = sv_from(string);
+    for (int i = 0; sv_splitstr_next(&rest, sep, &token); i++)
+        vect[i] = split_token(token);
     p(size) = n;
     return vect;
 }
+ll casemap_into(str buf, size_t cap, str string, char first, char last) {
+    if (string == NULL) {
+        handle_err(NullPtrError, "NULL pointer was trying to be copied\n");
+    }
+    size_t len = strlen(string);
+    if (cap > 0) {
+        size_t n = len < cap ? len : cap-1;
+        KERNEL(casemap)(buf, string, n, first, last);
+        buf[n] = '\0';
+    }
+    return len;
+}
 str toupperstr(str string) {
-    str ptr = strcopy(string);
-    for (int i = 0; i < strlen(string); i++) {
-        ptr[i] = toupper(ptr[i]);
+    PROFILE_SCOPE(PROFILE_LEN(string));
+    if (string == NULL) {
+        handle_err(NullPtrError, "NULL pointer was trying to be copied\n");
     }
+    strview view = sv_from(string);
+    str ptr = alloc_safe_str(view.len);
+    size_t chunks = parallel_chunks(view.len);
+    if (chunks > 1)
+        parallel_transform(chunk_toupper, view.ptr, ptr, view.len, 0, 0, chunks);
+    else
+        KERNEL(casemap)(ptr, view.ptr, view.len, 'a', 'z');
+    ptr[view.len] = '\0';
     return ptr;
 }
+ll toupperstr_into(str buf, size_t cap, str string) {
+    PROFILE_SCOPE(PROFILE_LEN(string));
+    return casemap_into(buf, cap, string, 'a', 'z');
+}
 str tolowerstr(str string) {
-    str ptr = strcopy(string);
-    for (int i = 0; i < strlen(string); i++) {
-        ptr[i] = tolower(ptr[i]);
+    PROFILE_SCOPE(PROFILE_LEN(string));
+    if (string == NULL) {
+        handle_err(NullPtrError, "NULL pointer was trying to be copied\n");
+    }
+    strview view = sv_from(string);
+    str ptr = alloc_safe_str(view.len);
+    size_t chunks = parallel_chunks(view.len);
+    if (chunks > 1)
+        parallel_transform(chunk_tolower, view.ptr, ptr, view.len, 0, 0, chunks);
+    else
+        KERNEL(casemap)(ptr, view.ptr, view.len, 'A', 'Z');
+    ptr[view.len] = '\0';
+    return ptr;
+}
+ll tolowerstr_into(str buf, size_t cap, str string) {
+    PROFILE_SCOPE(PROFILE_LEN(string));
+    return casemap_into(buf, cap, string, 'A', 'Z');
+}
+str toupperstr_locale(str string) {
+    PROFILE_SCOPE(PROFILE_LEN(string));
+    if (string == NULL) {
+        handle_err(NullPtrError, "NULL pointer was trying to be copied\n");
+    }
+    strview view = sv_from(string);
+    str ptr = alloc_safe_str(view.len);
+    for (size_t i = 0; i < view.len; i++)
+        ptr[i] = toupper((unsigned char)string[i]);
+    ptr[view.len] = '\0';
+    return ptr;
+}
+str tolowerstr_locale(str string) {
+    PROFILE_SCOPE(PROFILE_LEN(string));
+    if (string == NULL) {
+        handle_err(NullPtrError, "NULL pointer was trying to be copied\n");
     }
+    strview view = sv_from(string);
+    str ptr = alloc_safe_str(view.len);
+    for (size_t i = 0; i < view.len; i++)
+        ptr[i] = tolower((unsigned char)string[i]);
+    ptr[view.len] = '\0';
     return ptr;
 }
 str zip_string(str string) {
-    str ptr = strcopy(string);
-    uint n = strlen(string);
-    int i = 0;
-    int prev = 0;
-    while (ptr[i] != '\0') {
-        if (prev)  { i++; prev = 0; continue; }
-        if (ptr[i] != ' ' && ptr[i] != '\t' && ptr[i] != '\n' && ptr[i] != '\r') {
-            prev = 1; i++;
-        } else {
-            memmove(ptr+i, ptr+i+1, n-i);
-            n = strlen(ptr);
-        }
+    PROFILE_SCOPE(PROFILE_LEN(string));
+    if (string == NULL) {
+        handle_err(NullPtrError, "NULL pointer was trying to be copied\n");
     }
+    size_t len = strlen(string);
+    str ptr = alloc_safe_str(len);
+    zip_string_into(ptr, len+1, string);
     return ptr;
 }
+ll zip_string_into(str buf, size_t cap, str string) {
+    PROFILE_SCOPE(PROFILE_LEN(string));
+    return compact_into(buf, cap, string, &WHITESPACE_CS, 1);
+}
+
+size_t put_clamped(str dst, size_t cap, size_t at, const char* src, size_t len) {
+    if (at < cap)
+        memcpy(dst+at, src, len < cap-at ? len : cap-at);
+    return at + len;
+}
+
+void replace_prepare(replace_plan* plan, strview orig, strview needle, strview rep) {
+    size_t pos = 0;
+    ll i;
+    plan->stored = 0;
+    plan->matches = 0;
+    needle_init(&plan->cn, needle.ptr, needle.len, NEEDLE_FORWARD);
+    while (needle.len > 0 && (i = needle_find(&plan->cn, orig.ptr+pos, orig.len-pos)) != -1) {
+        if (plan->stored < REPLACE_BATCH)
+            plan->offsets[plan->stored++] = pos + i;
+        plan->matches++;
+        pos += i + needle.len;
+    }
+    plan->len = orig.len - plan->matches*needle.len + plan->matches*rep.len;
+}
+
+void replace_write(replace_plan* plan, str dst, size_t cap, strview orig, strview needle, strview rep) {
+    size_t j = 0, k = 0;
+    for (size_t m = 0; m < plan->matches; m++) {
+        // Only the first REPLACE_BATCH offsets are kept, the rest gets found again
+        size_t at = m < plan->stored ? plan->offsets[m] : j + needle_find(&plan->cn, orig.ptr+j, orig.len-j);
+        k = put_clamped(dst, cap, k, orig.ptr+j, at-j);
+        k = put_clamped(dst, cap, k, rep.ptr, rep.len);
+        j = at + needle.len;
+    }
+    put_clamped(dst, cap, k, orig.ptr+j, orig.len-j);
+}
 
 str replace(str orig, str needle, str rep) {
-    int n = count(orig, needle);
-    int a = strlen(orig);
-    int b = strlen(needle);
-    int c = strlen(rep);
-    ll len = a - n*b + n*c;
-    str ptr = alloc_safe_str(len);
-    int i, j = 0, k = 0;
-    while (n > 0) {
-        i = find(orig+j, needle) + j;
-        strncpy(ptr+k, orig+j, i-j);
-        ptr[k+i-j] = '\0';
-        strcat(ptr+k+i-j, rep);
-        k += (i-j) + c;
-        j = i + b;
-        n--;
-    }
-    strcat(ptr+k, orig+j);
+    PROFILE_SCOPE(PROFILE_LEN(orig));
+    if (orig == NULL || needle == NULL || rep == NULL) {
+        handle_err(NullPtrError, "NULL pointer was trying to be replaced\n");
+    }
+    strview o = sv_from(orig), n = sv_from(needle), r = sv_from(rep);
+    size_t chunks = parallel_chunks(o.len);
+    if (chunks > 1 && n.len > 0 && n.len <= o.len / chunks)
+        return parallel_replace(o, n, r, chunks);
+    replace_plan plan;
+    replace_prepare(&plan, o, n, r);
+    str ptr = alloc_safe_str(plan.len);
+    replace_write(&plan, ptr, plan.len, o, n, r);
+    ptr[plan.len] = '\0';
     return ptr;
 }
 
+ll replace_into(str buf, size_t cap, str orig, str needle, str rep) {
+    PROFILE_SCOPE(PROFILE_LEN(orig));
+    if (orig == NULL || needle == NULL || rep == NULL) {
+        handle_err(NullPtrError, "NULL pointer was trying to be replaced\n");
+    }
+    strview o = sv_from(orig), n = sv_from(needle), r = sv_from(rep);
+    replace_plan plan;
+    replace_prepare(&plan, o, n, r);
+    if (cap > 0) {
+        replace_write(&plan, buf, cap-1, o, n, r);
+        buf[plan.len < cap-1 ? plan.len : cap-1] = '\0';
+    }
+    return plan.len;
+}
+
 str replacec(str orig, char needle, char rep) {
-    str ptr = strcopy(orig);
-    for (int i = 0; i < strlen(ptr); i++) {
-        if (ptr[i] == needle)
-            ptr[i] = rep;
+    PROFILE_SCOPE(PROFILE_LEN(orig));
+    strview view = sv_from(orig);
+    size_t chunks = parallel_chunks(view.len);
+    if (chunks > 1) {
+        str ptr = alloc_safe_str(view.len);
+        parallel_transform(chunk_replacec, view.ptr, ptr, view.len, needle, rep, chunks);
+        ptr[view.len] = '\0';
+        return ptr;
     }
+    str ptr = sv_tostr(view);
+    KERNEL(replacec)(ptr, view.len, needle, rep);
     return ptr;
 }
+ll replacec_into(str buf, size_t cap, str orig, char needle, char rep) {
+    PROFILE_SCOPE(PROFILE_LEN(orig));
+    ll len = sv_into(buf, cap, sv_from(orig));
+    if (cap > 0)
+        KERNEL(replacec)(buf, (size_t)len < cap-1 ? (size_t)len : cap-1, needle, rep);
+    return len;
+}
 
-str substr(str orig, int start, int end) {
+// Case insensitive search: the haystack gets lowercased a window at a time and searched with the lowercased needle
+void icase_init(icase_search* s, strview needle) {
+    size_t window = 2 * needle.len > ICASE_WINDOW ? 2 * needle.len : ICASE_WINDOW;
+    s->mem = needle.len + window <= sizeof(s->buf) ? s->buf : (str)safe_alloc_generic(1, needle.len + window);
+    s->window = s->mem + needle.len;
+    s->cap = window;
+    s->base = 0;
+    s->filled = 0;
+    KERNEL(casemap)(s->mem, needle.ptr, needle.len, 'A', 'Z');
+    needle_init(&s->cn, s->mem, needle.len, NEEDLE_FORWARD);
+}
+
+// First match at or after from, the window is kept between calls so that walking the matches of the same haystack
+// lowercases every byte about once
+ll icase_find_from(icase_search* s, const char* haystack, size_t hlen, size_t from) {
+    size_t m = s->cn.len;
+    if (m == 0)
+        return from;
+    while (from + m <= hlen) {
+        if (s->filled == 0 || from < s->base || from + m > s->base + s->filled) {
+            s->base = from;
+            s->filled = hlen - from < s->cap ? hlen - from : s->cap;
+            KERNEL(casemap)(s->window, haystack + from, s->filled, 'A', 'Z');
+        }
+        size_t at = from - s->base;
+        ll i = needle_find(&s->cn, s->window + at, s->filled - at);
+        if (i != -1)
+            return from + i;
+        if (s->base + s->filled == hlen)
+            break;
+        // Matches starting in the last m-1 bytes of the window are left to the next one
+        from = s->base + s->filled - m + 1;
+    }
+    return -1;
+}
+
+ll icase_find(icase_search* s, const char* haystack, size_t hlen) {
+    s->filled = 0;
+    return icase_find_from(s, haystack, hlen, 0);
+}
+
+ll icase_count(icase_search* s, const char* haystack, size_t hlen) {
+    size_t m = s->cn.len;
+    ll total = 0;
+    if (m == 0)
+        return 0;
+    for (size_t pos = 0; pos + m <= hlen; pos += s->cap - m + 1) {
+        size_t n = hlen - pos < s->cap ? hlen - pos : s->cap;
+        KERNEL(casemap)(s->window, haystack + pos, n, 'A', 'Z');
+        total += needle_count(&s->cn, s->window, n);
+    }
+    return total;
+}
+
+void icase_free(icase_search* s) {
+    if (s->mem != s->buf)
+        free(s->mem);
+}
+
+int icase_equal(const char* a, const char* b, size_t len) {
+    for (size_t i = 0; i < len; i++) {
+        unsigned char x = a[i], y = b[i];
+        x |= ((unsigned char)(x - 'A') < 26) << 5;
+        y |= ((unsigned char)(y - 'A') < 26) << 5;
+        if (x != y)
+            return 0;
+    }
+    return 1;
+}
+
+int sv_istartswith(strview haystack, strview needle) {
+    PROFILE_SCOPE(haystack.len);
+    return needle.len <= haystack.len && icase_equal(haystack.ptr, needle.ptr, needle.len);
+}
+int sv_iendswith(strview haystack, strview needle) {
+    PROFILE_SCOPE(haystack.len);
+    return needle.len <= haystack.len && icase_equal(haystack.ptr+haystack.len-needle.len, needle.ptr, needle.len);
+}
+ll sv_ifind(strview haystack, strview needle) {
+    PROFILE_SCOPE(haystack.len);
+    icase_search s;
+    icase_init(&s, needle);
+    ll i = icase_find(&s, haystack.ptr, haystack.len);
+    icase_free(&s);
+    return i;
+}
+ll sv_icount(strview haystack, strview needle) {
+    PROFILE_SCOPE(haystack.len);
+    icase_search s;
+    icase_init(&s, needle);
+    ll n = icase_count(&s, haystack.ptr, haystack.len);
+    icase_free(&s);
+    return n;
+}
+
+int istartswith(str haystack, str needle) {
+    PROFILE_SCOPE(PROFILE_LEN(haystack));
+    if (haystack == NULL || needle == NULL)
+        return 0;
+    return sv_istartswith(sv_from(haystack), sv_from(needle));
+}
+int iendswith(str haystack, str needle) {
+    PROFILE_SCOPE(PROFILE_LEN(haystack));
+    if (haystack == NULL || needle == NULL)
+        return 0;
+    return sv_iendswith(sv_from(haystack), sv_from(needle));
+}
+int ifind(str haystack, str needle) {
+    PROFILE_SCOPE(PROFILE_LEN(haystack));
+    return (int)sv_ifind(sv_from(haystack), sv_from(needle));
+}
+int icount(str haystack, str needle) {
+    PROFILE_SCOPE(PROFILE_LEN(haystack));
+    return (int)sv_icount(sv_from(haystack), sv_from(needle));
+}
+
+str ireplace(str orig, str needle, str rep) {
+    PROFILE_SCOPE(PROFILE_LEN(orig));
+    if (orig == NULL || needle == NULL || rep == NULL) {
+        handle_err(NullPtrError, "NULL pointer was trying to be replaced\n");
+    }
+    strview o = sv_from(orig), n = sv_from(needle), r = sv_from(rep);
+    size_t offsets[REPLACE_BATCH], stored = 0, matches = 0, pos = 0;
+    ll i;
+    icase_search s;
+    icase_init(&s, n);
+    while (n.len > 0 && (i = icase_find_from(&s, o.ptr, o.len, pos)) != -1) {
+        if (stored < REPLACE_BATCH)
+            offsets[stored++] = i;
+        matches++;
+        pos = i + n.len;
+    }
+    size_t len = o.len - matches*n.len + matches*r.len, j = 0, k = 0;
+    str ptr = alloc_safe_str(len);
+    for (size_t m = 0; m < matches; m++) {
+        // Only the first REPLACE_BATCH offsets are kept, the rest gets found again
+        size_t at = m < stored ? offsets[m] : (size_t)icase_find_from(&s, o.ptr, o.len, j);
+        k = put_clamped(ptr, len, k, o.ptr+j, at-j);
+        k = put_clamped(ptr, len, k, r.ptr, r.len);
+        j = at + n.len;
+    }
+    put_clamped(ptr, len, k, o.ptr+j, o.len-j);
+    ptr[len] = '\0';
+    icase_free(&s);
+    return ptr;
+}
+
+strview substr_view(str orig, int start, int end) {
+    if (orig == NULL) {
+        handle_err(NullPtrError, "NULL pointer was trying to be copied\n");
+    }
     int len = strlen(orig);
     if (start > len || end > len || start < -1 || end < -1) {
         handle_err(InvalidSubstringIndex, "Substring received invalid range %d:%d", start, end);
     }
     if (start == -1 && end == -1)
-        return strcopy(orig);
+        return sv_fromn(orig, len);
 
     if (start > -1 && end == -1)
-        return strcopy(orig+start);
+        return sv_fromn(orig+start, len-start);
 
     if (start == -1 && end > -1)
-        return strncopy(orig, end);
+        return sv_fromn(orig, end);
 
     if ((end-start) > len || end < start) {
         handle_err(InvalidSubstringIndex, "Substring received invalid range %d:%d", start, end);
     }
+    return sv_fromn(orig+start, end-start);
+}
+str substr(str orig, int start, int end) {
+    PROFILE_SCOPE(PROFILE_LEN(orig));
+    return sv_tostr(substr_view(orig, start, end));
+}
+ll substr_into(str buf, size_t cap, str orig, int start, int end) {
+    PROFILE_SCOPE(PROFILE_LEN(orig));
+    return sv_into(buf, cap, substr_view(orig, start, end));
+}
 
-    if (end == start)
-        return strcopy("");
+ll batch_trim(str buf, size_t cap, str string, const batch_args* args) { (void)args; return trim_into(buf, cap, string); }
+ll batch_trimchar(str buf, size_t cap, str string, const batch_args* args) { return trimchar_into(buf, cap, string, args->c); }
+ll batch_trimnchar(str buf, size_t cap, str string, const batch_args* args) { return trimcs_into(buf, cap, string, &args->cs); }
+ll batch_toupperstr(str buf, size_t cap, str string, const batch_args* args) { (void)args; return toupperstr_into(buf, cap, string); }
+ll batch_tolowerstr(str buf, size_t cap, str string, const batch_args* args) { (void)args; return tolowerstr_into(buf, cap, string); }
+ll batch_replacec(str buf, size_t cap, str string, const batch_args* args) { return replacec_into(buf, cap, string, args->c, args->rep); }
+ll batch_replace(str buf, size_t cap, str string, const batch_args* args) { return replace_into(buf, cap, string, args->needle, args->with); }
+ll batch_zip_string(str buf, size_t cap, str string, const batch_args* args) { (void)args; return zip_string_into(buf, cap, string); }
+ll batch_sub(str buf, size_t cap, str string, const batch_args* args) { return sub_into(buf, cap, string, args->c); }
 
-    return strncopy(orig+start, end-start);
+// Results are never longer than their string unless grows is set, in which case they're measured first
+strbatch batch_run(str* strings, int n, ll (*op)(str buf, size_t cap, str string, const batch_args* args), const batch_args* args, int grows) {
+    if (strings == NULL && n > 0) {
+        handle_err(NullPtrError, "NULL pointer was trying to be batched\n");
+    }
+    size_t total = 0;
+    for (int i = 0; i < n; i++) {
+        if (strings[i] == NULL) {
+            handle_err(NullPtrError, "NULL pointer was trying to be batched\n");
+        }
+        total += (grows ? (size_t)op(NULL, 0, strings[i], args) : strlen(strings[i])) + 1;
+    }
+    strbatch batch;
+    size_t head = sizeof(size_t) * (n + 1);
+    batch.offsets = (size_t*)alloc_safe_str(head + total);
+    batch.data = (str)batch.offsets + head;
+    batch.count = n;
+    size_t at = 0;
+    for (int i = 0; i < n; i++) {
+        batch.offsets[i] = at;
+        at += op(batch.data + at, total - at, strings[i], args) + 1;
+    }
+    batch.offsets[n] = at;
+    return batch;
+}
+
+strbatch trim_batch(str* strings, int n) {
+    PROFILE_SCOPE(0);
+    return batch_run(strings, n, batch_trim, NULL, 0);
+}
+strbatch trimchar_batch(str* strings, int n, char c) {
+    PROFILE_SCOPE(0);
+    batch_args args = { .c = c };
+    return batch_run(strings, n, batch_trimchar, &args, 0);
+}
+strbatch trimnchar_batch(str* strings, int n, str params) {
+    PROFILE_SCOPE(0);
+    batch_args args = { .cs = charset_from(params) };
+    return batch_run(strings, n, batch_trimnchar, &args, 0);
+}
+strbatch toupperstr_batch(str* strings, int n) {
+    PROFILE_SCOPE(0);
+    return batch_run(strings, n, batch_toupperstr, NULL, 0);
+}
+strbatch tolowerstr_batch(str* strings, int n) {
+    PROFILE_SCOPE(0);
+    return batch_run(strings, n, batch_tolowerstr, NULL, 0);
+}
+strbatch replacec_batch(str* strings, int n, char needle, char rep) {
+    PROFILE_SCOPE(0);
+    batch_args args = { .c = needle, .rep = rep };
+    return batch_run(strings, n, batch_replacec, &args, 0);
+}
+strbatch replace_batch(str* strings, int n, str needle, str rep) {
+    PROFILE_SCOPE(0);
+    batch_args args = { .needle = needle, .with = rep };
+    return batch_run(strings, n, batch_replace, &args, sv_from(rep).len > sv_from(needle).len);
+}
+strbatch zip_string_batch(str* strings, int n) {
+    PROFILE_SCOPE(0);
+    return batch_run(strings, n, batch_zip_string, NULL, 0);
+}
+strbatch sub_batch(str* strings, int n, char needle) {
+    PROFILE_SCOPE(0);
+    batch_args args = { .c = needle };
+    return batch_run(strings, n, batch_sub, &args, 0);
+}
+void free_batch(strbatch* batch) {
+    if (batch == NULL)
+        return;
+    free_string((str)batch->offsets);
+    batch->offsets = NULL;
+    batch->data = NULL;
+    batch->count = 0;
 }
 
 void** safe_alloc_generic(size_t size, size_t count) {
+    PROFILE_ALLOC(size*count);
     void** ptr = calloc(size, count);
     if (ptr == NULL) {
         handle_err(NullPtrError, "Memory %lu bytes couldn't be alloc'd\n", (ulint)(size*count));
@@ -533,22 +4892,136 @@ void** safe_alloc_generic(size_t size, size_t count) {
 }
 
 str alloc_safe_str(size_t size) {
-    str ptr = malloc(size+1);
-    if (ptr == NULL) {
-        handle_err(NullPtrError, "Memory %lu bytes couldn't be alloc'd\n", (ulint)(size));
-    }
-    if (structs.contains == 0) {
-        structs.strings = malloc(sizeof(vstr)*structs.max_size);
-    } else if (structs.max_size == structs.contains) {
-        structs.max_size *= 2;
-        structs.strings = realloc(structs.strings, sizeof(vstr)*structs.max_size);
+    PROFILE_ALLOC(size+1);
+    alloc_header* header;
+    if (ARENA != NULL) {
+        header = arena_alloc(ARENA, sizeof(alloc_header) + size+1);
+        if (header == NULL)
+            return NULL;
+        header->flags = ALLOC_ARENA;
+    } else {
+        header = malloc(sizeof(alloc_header) + size+1);
+        if (header == NULL) {
+            handle_err(NullPtrError, "Memory %lu bytes couldn't be alloc'd\n", (ulint)(size));
+            return NULL;
+        }
+        header->flags = 0;
     }
-    structs.strings[structs.contains] = ptr;
-    structs.contains++;
+    header->count = 0;
+    str ptr = (str)(header + 1);
+    if (ARENA == NULL)
+        register_string(ptr);
     ptr[0] = '\0';
     return ptr;
 }
 
+void free_string(str string) {
+    if (string == NULL || (HEADER(string)->flags & (ALLOC_ARENA | ALLOC_INTERNED)))
+        return;
+    if ((HEADER(string)->flags & ALLOC_DETACHED) || unregister_string(string))
+        free(HEADER(string));
+}
+
+void free_vect(vstr vect) {
+    if (vect == NULL || (HEADER(vect)->flags & ALLOC_ARENA))
+        return;
+    if ((HEADER(vect)->flags & ALLOC_DETACHED) || unregister_vect(vect)) {
+        for (unsigned int i = 0; i < HEADER(vect)->count; i++)
+            free_string(vect[i]);
+        free(HEADER(vect));
+    }
+}
+
+stringutils_arena_chunk* arena_new_chunk(size_t size) {
+    stringutils_arena_chunk* chunk = malloc(sizeof(stringutils_arena_chunk) + size);
+    if (chunk == NULL) {
+        handle_err(NullPtrError, "Memory %lu bytes couldn't be alloc'd\n", (ulint)(size));
+        return NULL;
+    }
+    chunk->next = NULL;
+    chunk->size = size;
+    chunk->used = 0;
+    return chunk;
+}
+
+void* arena_alloc(stringutils_arena* arena, size_t size) {
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    stringutils_arena_chunk* head = arena->head;
+    if (head->size - head->used >= size) {
+        void* ptr = (char*)(head + 1) + head->used;
+        head->used += size;
+        return ptr;
+    }
+    stringutils_arena_chunk* chunk = arena_new_chunk(size > arena->chunk_size ? size : arena->chunk_size);
+    if (chunk == NULL)
+        return NULL;
+    arena->chunks++;
+    if (size > arena->chunk_size) {
+        // oversized requests get a dedicated chunk behind the head so the current chunk keeps filling up
+        chunk->next = head->next;
+        head->next = chunk;
+    } else {
+        chunk->next = head;
+        arena->head = chunk;
+    }
+    chunk->used = size;
+    return chunk + 1;
+}
+
+stringutils_arena* create_arena_stringutils(size_t chunk_size) {
+    if (chunk_size == 0)
+        chunk_size = ARENA_CHUNK;
+    chunk_size = (chunk_size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    stringutils_arena* arena = malloc(sizeof(stringutils_arena));
+    if (arena == NULL) {
+        handle_err(NullPtrError, "Memory %lu bytes couldn't be alloc'd\n", (ulint)sizeof(stringutils_arena));
+        return NULL;
+    }
+    arena->chunk_size = chunk_size;
+    arena->head = arena_new_chunk(chunk_size);
+    if (arena->head == NULL) {
+        free(arena);
+        return NULL;
+    }
+    arena->chunks = 1;
+    return arena;
+}
+
+stringutils_arena* use_arena_stringutils(stringutils_arena* arena) {
+    stringutils_arena* prev = ARENA;
+    ARENA = arena;
+    return prev;
+}
+
+void reset_arena_stringutils(stringutils_arena* arena) {
+    if (arena == NULL)
+        return;
+    stringutils_arena_chunk* keep = arena->head;
+    stringutils_arena_chunk* chunk = keep->next;
+    while (chunk != NULL) {
+        stringutils_arena_chunk* next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    keep->next = NULL;
+    keep->used = 0;
+    arena->chunks = 1;
+}
+
+void destroy_arena_stringutils(stringutils_arena* arena) {
+    if (arena == NULL)
+        return;
+    if (ARENA == arena)
+        ARENA = NULL;
+    stringutils_arena_chunk* chunk = arena->head;
+    while (chunk != NULL) {
+        stringutils_arena_chunk* next = chunk->next;
+        free(chunk);
+        chunk = next;
+    }
+    free(arena);
+}
+
 alloced_strings* expose_internal_strings() {
     return &structs;
 }
@@ -557,28 +5030,173 @@ alloced_vects* expose_internal_vectors() {
     return &vstructs;
 }
 
-void free_all_structures() {
+stringutils_profile_entry* expose_internal_profile() {
+#ifdef STRINGUTILS_PROFILE
+    return __atomic_load_n(&PROFILE_HEAD, __ATOMIC_ACQUIRE);
+#else
+    return NULL;
+#endif
+}
+
+int snapshot_profile_stringutils(stringutils_profile_entry* entries, int max) {
+    int n = 0;
+    for (stringutils_profile_entry* entry = expose_internal_profile(); entry != NULL; entry = entry->next) {
+        if (n < max) {
+            entries[n] = *entry;
+            entries[n].next = NULL;
+            if (n > 0)
+                entries[n-1].next = &entries[n];
+        }
+        n++;
+    }
+    return n;
+}
+
+void reset_profile_stringutils() {
+    for (stringutils_profile_entry* entry = expose_internal_profile(); entry != NULL; entry = entry->next) {
+        entry->calls = 0;
+        entry->bytes = 0;
+        entry->ticks = 0;
+        entry->allocated = 0;
+        memset(entry->histogram, 0, sizeof(entry->histogram));
+    }
+}
+
+void dump_profile_stringutils(FILE* file) {
+    if (file == NULL) {
+        handle_err(NullPtrError, "NULL pointer was trying to be written to\n");
+    }
+    fprintf(file, "[");
+    int first = 1;
+    for (stringutils_profile_entry* entry = expose_internal_profile(); entry != NULL; entry = entry->next) {
+        if (entry->calls == 0)
+            continue;
+        fprintf(file, "%s\n  {\"function\": \"%s\", \"calls\": %llu, \"bytes\": %llu, \"ticks\": %llu, \"allocated\": %llu, \"histogram\": [",
+                first ? "" : ",", entry->function, entry->calls, entry->bytes, entry->ticks, entry->allocated);
+        int last = 63;
+        while (last > 0 && entry->histogram[last] == 0)
+            last--;
+        for (int i = 0; i <= last; i++)
+            fprintf(file, i ? ", %llu" : "%llu", entry->histogram[i]);
+        fprintf(file, "]}");
+        first = 0;
+    }
+    fprintf(file, "\n]\n");
+}
+
+#ifdef STRINGUTILS_PROFILE
+void profile_dump_at_exit(void) {
+    if (PROFILE_DUMP_PATH[0] == '\0')
+        return;
+    FILE* file = fopen(PROFILE_DUMP_PATH, "w");
+    if (file == NULL)
+        return;
+    dump_profile_stringutils(file);
+    fclose(file);
+}
+#endif
+
+void set_profile_dump_stringutils(const char* path) {
+#ifdef STRINGUTILS_PROFILE
+    static int registered = 0;
+    if (path == NULL) {
+        PROFILE_DUMP_PATH[0] = '\0';
+        return;
+    }
+    strncpy(PROFILE_DUMP_PATH, path, sizeof(PROFILE_DUMP_PATH) - 1);
+    if (!registered) {
+        atexit(profile_dump_at_exit);
+        registered = 1;
+    }
+#else
+    (void)path;
+#endif
+}
+
+void free_all_stringutils_structures() {
     if (structs.contains > 0) {
         for (ll i = 0; i < structs.contains; i++) {
-            free(structs.strings[i]);
+            free(HEADER(structs.strings[i]));
         }
-        free(structs.strings);
-        structs.contains = 0;
     }
+    free(structs.strings);
+    structs.strings = NULL;
+    structs.contains = 0;
     if (vstructs.contains > 0) {
         for (ll i = 0; i < vstructs.contains; i++) {
-            free(vstructs.vectors[i]);
+            free(HEADER(vstructs.vectors[i]));
         }
-        free(vstructs.vectors);
-        vstructs.contains = 0;
     }
+    free(vstructs.vectors);
+    vstructs.vectors = NULL;
+    vstructs.contains = 0;
+    clear_interned_stringutils();
 }
 
 void user_init(ll max_strings, ll max_vect) {
+    INIT_STRINGS = max_strings;
+    INIT_VECT = max_vect;
     structs.max_size = max_strings;
     vstructs.max_size = max_vect;
 }
 
+void parallel_init_stringutils(int threads, size_t min_chunk) {
+    PROFILE_SCOPE(0);
+#ifdef PARALLEL_POOL
+    pthread_mutex_lock(&POOL.submit);
+    pool_stop();
+    __atomic_store_n(&PARALLEL_MIN, min_chunk > 0 ? min_chunk : PARALLEL_CHUNK, __ATOMIC_RELAXED);
+    if (threads == 0)
+        threads = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    // The thread submitting the work helps, so one less worker is needed
+    if (threads > 1) {
+        POOL.threads = (pthread_t*)safe_alloc_generic(sizeof(pthread_t), threads - 1);
+        int started = 0;
+        while (started < threads - 1 && pthread_create(&POOL.threads[started], NULL, pool_worker, NULL) == 0)
+            started++;
+        __atomic_store_n(&POOL.count, started, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&POOL.submit);
+#else
+    (void)threads;
+    (void)min_chunk;
+#endif
+}
+
+str detach_string_stringutils(str string) {
+    if (string == NULL || !unregister_string(string))
+        return NULL;
+    HEADER(string)->flags |= ALLOC_DETACHED;
+    return string;
+}
+
+void adopt_string_stringutils(str string) {
+    if (string == NULL) {
+        handle_err(NullPtrError, "NULL pointer was trying to be adopted\n");
+    }
+    if (HEADER(string)->flags & ALLOC_DETACHED)
+        register_string(string);
+}
+
+vstr detach_vect_stringutils(vstr vect, int size) {
+    if (vect == NULL || !unregister_vect(vect))
+        return NULL;
+    HEADER(vect)->flags |= ALLOC_DETACHED;
+    for (int j = 0; j < size; j++)
+        detach_string_stringutils(vect[j]);
+    return vect;
+}
+
+void adopt_vect_stringutils(vstr vect, int size) {
+    if (vect == NULL) {
+        handle_err(NullPtrError, "NULL pointer was trying to be adopted\n");
+    }
+    if (HEADER(vect)->flags & ALLOC_DETACHED)
+        register_vect(vect);
+    for (int i = 0; i < size; i++)
+        adopt_string_stringutils(vect[i]);
+}
+
 void override_signal_exception_stringutils(void (*func)(int)) {
     SIGNAL_USR_StringUtils = 1;
     void* ret = signal(SIGUSR1, func);
@@ -602,6 +5220,10 @@ char* errcodetostr_stringutils(StringUtilsErrors err) {
             return "InvalidSubStringIndex";
         case SignalHandlerError:
             return "SignalHandlerError";
+        case InvalidPattern:
+            return "InvalidPattern";
+        case ReadError:
+            return "ReadError";
     }
 }
 
@@ -614,3 +5236,43 @@ char* errcodetostr_stringutils(StringUtilsErrors err) {
 #undef ll
 #undef MAX_STRINGS
 #undef MAX_VECT
+#undef ARENA_CHUNK
+#undef ARENA_ALIGN
+#undef HEADER
+#undef ALLOC_ARENA
+#undef ALLOC_DETACHED
+#undef ALLOC_INTERNED
+#undef INTERN_SLOTS
+#undef HISTOGRAM_SLOTS
+#undef ROPE_STOP
+#undef CS_HAS
+#undef CHARSET_SSSE3_TABLES
+#undef CHARSET_AVX2_TABLES
+#undef SHORT_NEEDLE
+#undef PAIR_BUDGET
+#undef NEEDLE_FORWARD
+#undef NEEDLE_REVERSE
+#undef MAX_DFA_ENTRIES
+#undef GLOB_MAX_WORDS
+#undef GLOB_HAS
+#undef POW10_MIN
+#undef POW10_MAX
+#undef POW10_LIMBS
+#undef REPLACE_BATCH
+#undef ICASE_WINDOW
+#undef COMPACT_BLOCK
+#undef TOKENIZER_BUFFER
+#undef PARALLEL_CHUNK
+#undef PARALLEL_POOL
+#undef CHUNK_LO
+#undef CHUNK_HI
+#undef READ_FD
+#undef THREAD_LOCAL
+#undef ATOMIC
+#undef THREAD_EXIT_HOOK
+#undef X86_SIMD
+#undef KERNEL
+#undef PROFILE_ADD
+#undef PROFILE_LEN
+#undef PROFILE_SCOPE
+#undef PROFILE_ALLOC
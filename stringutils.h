@@ -23,7 +23,9 @@ typedef enum StringUtilsErrors {
     NullPtrError = 0,
     EmptySeparator = 1,
     InvalidSubstringIndex = 2,
-    SignalHandlerError = 3
+    SignalHandlerError = 3,
+    InvalidPattern = 4,
+    ReadError = 5
 } StringUtilsErrors;
 
 
@@ -31,14 +33,18 @@ typedef enum StringUtilsErrors {
  * @brief The types of tracing available in this library
  * <br> NoTrace is completely silent execution
  * <br> Warn warns on errors (if custom error handler is present, it kills the program otherwise)
+ * <br> Profile is the same as Warn but also records per function statistics, if the library was compiled with STRINGUTILS_PROFILE
  */
 typedef enum StringUtilsTraceLvl {
     NoTrace = 0,
-    Warn = 1
+    Warn = 1,
+    Profile = 2
 } StringUtilsTraceLvl;
 
 /**
  * This is the internal structure that holds all references to any string that gets allocated within this library.
+ * If the library is compiled with STRINGUTILS_PER_THREAD defined, each thread gets its own instance of this struct,
+ * so that different threads can safely call into the library at the same time.
  * By default it starts out with max_size of 1000, you can override this by calling user_init() at the start of the program.
  * It will auto expand as needed, doubling its size every time to avoid O(n) spent allocating when limit is reached.
  * @param strings: the list of refs to all the allocated strings
@@ -70,6 +76,439 @@ typedef struct alloced_vects {
     unsigned long long max_size;
 } alloced_vects;
 
+/**
+ * These are the statistics recorded for a single function while the trace level is Profile (only if compiled with STRINGUTILS_PROFILE).
+ * Only calls made by the user are recorded, calls made by the library to itself count towards the function the user called.
+ * @param function: name of the function
+ * @param calls: number of calls
+ * @param bytes: bytes processed (the length of the input string or view, for functions that take one)
+ * @param ticks: total time spent (TSC cycles on x86, nanoseconds elsewhere)
+ * @param allocated: bytes allocated for the strings, lists of strings and internal objects returned
+ * @param histogram: histogram[i] is the number of calls that took between 2^i and 2^(i+1) ticks
+ * @param registered: used internally
+ * @param next: the next function
+ * @see expose_internal_profile()
+ */
+typedef struct stringutils_profile_entry {
+    const char* function;
+    unsigned long long calls;
+    unsigned long long bytes;
+    unsigned long long ticks;
+    unsigned long long allocated;
+    unsigned long long histogram[64];
+    int registered;
+    struct stringutils_profile_entry* next;
+} stringutils_profile_entry;
+
+/**
+ * This is the header of a single block of memory owned by a stringutils_arena.
+ * The usable bytes follow this header directly in memory.
+ * @param next: the next (older) chunk of the arena
+ * @param size: the number of usable bytes in this chunk
+ * @param used: the number of bytes already handed out from this chunk
+ */
+typedef struct stringutils_arena_chunk {
+    struct stringutils_arena_chunk* next;
+    size_t size;
+    size_t used;
+} stringutils_arena_chunk;
+
+/**
+ * This is a bump-pointer allocator that can replace alloced_strings/alloced_vects for a limited scope.
+ * While an arena is in use (see use_arena_stringutils()) every string and list of strings made by this library is carved out of it,
+ * nothing gets pushed into the internal structs and nothing gets freed by free_all_stringutils_structures().
+ * Memory is released all at once with reset_arena_stringutils() or destroy_arena_stringutils(), both O(chunks).
+ * @param head: the chunk currently being filled
+ * @param chunk_size: the size of each newly allocated chunk
+ * @param chunks: the current number of chunks held by the arena
+ * @see create_arena_stringutils()
+ */
+typedef struct stringutils_arena {
+    stringutils_arena_chunk* head;
+    size_t chunk_size;
+    unsigned long long chunks;
+} stringutils_arena;
+
+/**
+ * This is a non-owning view over a run of bytes, usually part of a bigger string.
+ * Views aren't NUL terminated and never get allocated, freed or tracked by this library,
+ * they are only valid as long as the buffer they point into is.
+ * @param ptr: pointer to the first byte of the view
+ * @param len: number of bytes in the view
+ * @see sv_from()
+ */
+typedef struct strview {
+    const char* ptr;
+    size_t len;
+} strview;
+
+/**
+ * This is a needle preprocessed for repeated searches with find_compiled(), rfind_compiled() and count_compiled().
+ * Short needles are matched with a SIMD filter on their first and last byte, longer ones with the Two-Way algorithm
+ * (linear in the worst case, sublinear on average thanks to a bad character shift), reverse searches use Horspool.
+ * @param ptr: the needle (owned by the struct when made by compile_needle())
+ * @param len: length of the needle
+ * @param critical: position of the critical factorization (Two-Way)
+ * @param period: shift applied after the left half of the needle matched (Two-Way)
+ * @param memory: number of bytes known to match after a shift by period (Two-Way)
+ * @param shift: last position+1 of each byte in the needle, 0 if absent
+ * @param rshift: first position of each byte in needle[1:], len if absent
+ * @see compile_needle()
+ */
+typedef struct compiled_needle {
+    const char* ptr;
+    size_t len;
+    size_t critical;
+    size_t period;
+    size_t memory;
+    size_t shift[256];
+    size_t rshift[256];
+} compiled_needle;
+
+/**
+ * This is a set of patterns compiled into an Aho-Corasick automaton, so that all of them are searched for in a single pass.
+ * States are numbered from 0 (the root), transitions are stored as a flat list per state, plus a full table for the root.
+ * Unless the automaton is huge, the transitions are also expanded into a DFA table so that searching costs one lookup per byte.
+ * @param patterns: number of patterns
+ * @param states: number of states of the automaton
+ * @param lens: length of each pattern
+ * @param out: pattern ending in each state, -1 if none (duplicate patterns are reported as the first one)
+ * @param fail: failure link of each state
+ * @param dict: closest state on the failure chain where a pattern ends, 0 if none
+ * @param first: index of the first transition of each state in bytes/next, states+1 entries
+ * @param bytes: byte of each transition
+ * @param next: target state of each transition
+ * @param root: transition from the root for every possible byte
+ * @param classes: number of byte classes, bytes that don't appear in any pattern share class 0
+ * @param cls: class of each byte
+ * @param delta: full transition table (states * classes), NULL if the automaton is too big for one
+ * @see compile_patterns()
+ */
+typedef struct multi_pattern {
+    int patterns;
+    int states;
+    size_t* lens;
+    int* out;
+    int* fail;
+    int* dict;
+    int* first;
+    unsigned char* bytes;
+    int* next;
+    int root[256];
+    int classes;
+    unsigned char cls[256];
+    int* delta;
+} multi_pattern;
+
+/**
+ * @brief Options for compile_glob(), they can be combined with |
+ * <br> GlobPathname makes '*', '?' and classes stop at '/', "**" still matches any sequence
+ * <br> GlobCaseless makes letters match regardless of their ASCII case
+ */
+typedef enum StringUtilsGlobFlags {
+    GlobDefault = 0,
+    GlobPathname = 1,
+    GlobCaseless = 2
+} StringUtilsGlobFlags;
+
+/**
+ * This is a glob pattern compiled into a bit-parallel automaton: bit s of the state is set while the text read so far
+ * can match the first s single byte items of the pattern, and a '*' keeps its bit set for the bytes it can stand for.
+ * Stepping over a byte costs a shift, an and and an or every 64 items, so matching never allocates nor backtracks.
+ * The items before the first '*' and after the last one always match a fixed number of bytes and are checked directly.
+ * @param atoms: number of single byte items ('?', classes and plain bytes)
+ * @param words: 64 bit words in a state, atoms / 64 + 1
+ * @param head: items before the first '*', all of them if there isn't one
+ * @param tail: items after the last '*', 0 if there isn't one
+ * @param stars: 1 if the pattern has any '*'
+ * @param open: 1 if only a '*' matching every byte sits between head and tail, so they're all that needs checking
+ * @param masks: bit s + 1 of the words at masks + c * words is set if item s matches byte c
+ * @param loops: bit s of the words at loops + c * words is set if a '*' right before item s matches byte c
+ * @see compile_glob()
+ */
+typedef struct glob_pattern {
+    size_t atoms;
+    size_t words;
+    size_t head;
+    size_t tail;
+    int stars;
+    int open;
+    unsigned long long* masks;
+    unsigned long long* loops;
+} glob_pattern;
+
+/**
+ * This is a precompiled set of characters, it can replace the params string of trimnchar(), countnc(), splitnc() and the like.
+ * Checking if a character belongs to it takes a single lookup, no matter how many characters it holds.
+ * @param bits: 256 bit bitmap, one bit per possible byte
+ * @param lo: for every low nibble, bitmask of the high nibbles 0-7 that are in the set (used for SIMD lookups)
+ * @param hi: for every low nibble, bitmask of the high nibbles 8-15 that are in the set (used for SIMD lookups)
+ * @see charset_from()
+ */
+typedef struct charset {
+    unsigned char bits[32];
+    unsigned char lo[16];
+    unsigned char hi[16];
+} charset;
+
+/**
+ * @brief The kinds of separators a stream_tokenizer can split at, mirroring split(), splitc(), splitcs() and splitstr()
+ */
+typedef enum TokenSeparator {
+    SepWhitespace = 0,
+    SepChar = 1,
+    SepCharset = 2,
+    SepString = 3
+} TokenSeparator;
+
+/**
+ * This describes where a stream_tokenizer splits its input, build it with sep_whitespace(), sep_char(), sep_charset() or sep_string().
+ * @param kind: what kind of separator this is
+ * @param c: the separator for SepChar
+ * @param cs: the separators for SepWhitespace and SepCharset
+ * @param needle: the separator for SepString (not copied, it has to outlive the tokenizer)
+ */
+typedef struct token_separator {
+    TokenSeparator kind;
+    char c;
+    charset cs;
+    strview needle;
+} token_separator;
+
+/**
+ * This is a tokenizer that reads from a FILE* or a file descriptor into a fixed buffer and hands out one token at a time.
+ * Memory use is bounded by the buffer size no matter how big the input is, tokens that straddle two reads are handled.
+ * A token longer than the buffer is handed out in pieces, with truncated set on all but the last one.
+ * @param file: the stream to read from (NULL when reading from fd)
+ * @param fd: the file descriptor to read from (-1 when reading from file)
+ * @param buf: the read buffer
+ * @param cap: size of buf
+ * @param start: index in buf of the first byte that wasn't handed out yet
+ * @param end: index in buf past the last byte read
+ * @param scanned: number of bytes after start known not to hold a separator
+ * @param eof: set once the input is exhausted
+ * @param done: set once the last token was handed out
+ * @param truncated: set if the last token handed out didn't fit in the buffer and continues in the next one
+ * @param error: set if reading the input failed, the tokens handed out before it are all that was read
+ * @param sep: where to split
+ * @param cn: compiled separator (SepString only)
+ * @see tokenizer_open_file()
+ */
+typedef struct stream_tokenizer {
+    FILE* file;
+    int fd;
+    char* buf;
+    size_t cap;
+    size_t start;
+    size_t end;
+    size_t scanned;
+    int eof;
+    int done;
+    int truncated;
+    int error;
+    token_separator sep;
+    compiled_needle cn;
+} stream_tokenizer;
+
+/**
+ * This reads delimited records as described by RFC 4180: fields end at the delimiter, records at "\n" or "\r\n",
+ * and a field can be quoted with '"' to hold delimiters and newlines, "" standing for a quote inside a quoted field.
+ * The input is classified 64 bytes at a time: quotes, delimiters and newlines each become a bitmask, the bytes inside quotes
+ * are the prefix xor of the quote mask (a single carry-less multiply where the cpu has one) and so quoted delimiters
+ * and newlines drop out without looking at the bytes one by one.
+ * @param file: stream to read from, NULL for a file descriptor or in memory input
+ * @param fd: file descriptor to read from, -1 for a stream or in memory input
+ * @param data: the input if it's in memory, else buf
+ * @param buf: the read buffer, it grows to hold the longest record (NULL for in memory input)
+ * @param cap: size of buf
+ * @param start: index in data where the next record starts
+ * @param end: index in data past the last byte of input available
+ * @param block: index in data of the block pending belongs to
+ * @param scanned: index in data of the next block to classify
+ * @param pending: delimiters and newlines outside quotes, in the current block, not handed out yet
+ * @param inside: all ones if the last classified byte is inside quotes, else 0
+ * @param eof: set once the input is exhausted
+ * @param error: set if reading the input failed, the records handed out before it are all that was read
+ * @param delim: field delimiter
+ * @param fields: fields of the last record handed out
+ * @param field_cap: room in fields
+ * @see csv_open()
+ * @see csv_open_file()
+ */
+typedef struct csv_reader {
+    FILE* file;
+    int fd;
+    const char* data;
+    char* buf;
+    size_t cap;
+    size_t start;
+    size_t end;
+    size_t block;
+    size_t scanned;
+    unsigned long long pending;
+    unsigned long long inside;
+    int eof;
+    int error;
+    char delim;
+    strview* fields;
+    size_t field_cap;
+} csv_reader;
+
+/**
+ * This is a file mapped read-only in memory (read in a heap buffer on Windows) together with the offsets of its lines.
+ * Lines are the tokens splitc() would return for the file contents split at '\n', so a trailing newline gives an empty last line.
+ * @param data: contents of the file, <b>NOT</b> NUL terminated
+ * @param size: size of the file in bytes
+ * @param lines: offset of the start of each line, lines[count] is size+1
+ * @param count: number of lines
+ * @param mapped: 1 if data is a mapping, 0 otherwise
+ * @see map_file()
+ */
+typedef struct mapped_file {
+    const char* data;
+    size_t size;
+    size_t* lines;
+    size_t count;
+    int mapped;
+} mapped_file;
+
+/**
+ * This is a growable string, appending to it is amortized O(1) since the capacity doubles every time it runs out.
+ * The buffer is always NUL terminated. If an arena is in use when the builder is initialized, the buffer is carved out of it.
+ * @param buf: the characters appended so far
+ * @param len: length of the string
+ * @param cap: size of buf
+ * @param arena: arena the buffer lives in (NULL if it's on the heap)
+ * @see sb_init()
+ */
+typedef struct strbuilder {
+    char* buf;
+    size_t len;
+    size_t cap;
+    stringutils_arena* arena;
+} strbuilder;
+
+/**
+ * This is the result of a batch function: one result per input string, all stored in a single allocation.
+ * Result i is the NUL terminated string data + offsets[i], its length is offsets[i+1] - offsets[i] - 1.
+ * @param data: the results, back to back
+ * @param offsets: where each result starts in data, offsets[count] is the end of the last one
+ * @param count: number of results
+ * @see trim_batch()
+ */
+typedef struct strbatch {
+    char* data;
+    size_t* offsets;
+    size_t count;
+} strbatch;
+
+/**
+ * This is a token together with how many times a token_histogram saw it.
+ * @param token: the token, NUL terminated, owned by the histogram
+ * @param count: how many times it was counted (an upper bound if error isn't 0)
+ * @param error: how much count can be over the real number, only non zero for tokens that took the place of an evicted one
+ * @see token_histogram
+ */
+typedef struct token_count {
+    strview token;
+    unsigned long long count;
+    unsigned long long error;
+} token_count;
+
+/**
+ * This counts how many times each distinct token shows up, only one copy of every distinct token is kept.
+ * Without a limit every count is exact. With a limit of max tokens memory stays bounded whatever the input size:
+ * once full, a new token replaces the least counted one (Space-Saving), every token seen more than total/max times
+ * is guaranteed to be kept and counts are overestimated by at most their error.
+ * @param entries: the distinct tokens and their counts, in no particular order
+ * @param count: number of entries
+ * @param max: most distinct tokens kept (0 for no limit)
+ * @param total: number of tokens counted
+ * @param evicted: number of times a token was replaced by another one
+ * @param cap: size of entries
+ * @param hashes: hash of every entry
+ * @param rooms: bytes reserved for the token of every entry
+ * @param slots: open addressing table of entry indices + 1 (0 for an empty slot)
+ * @param slot_cap: size of slots, a power of 2
+ * @param heap: entry indices ordered as a min-heap by count (only once the limit is reached)
+ * @param heap_pos: position of every entry in heap
+ * @param scratch: buffer used to join tokens longer than the read buffer of a file
+ * @param scratch_cap: size of scratch
+ * @param arena: where the tokens are stored
+ * @see histogram_create()
+ */
+typedef struct token_histogram {
+    token_count* entries;
+    size_t count;
+    size_t max;
+    unsigned long long total;
+    unsigned long long evicted;
+    size_t cap;
+    unsigned long long* hashes;
+    size_t* rooms;
+    size_t* slots;
+    size_t slot_cap;
+    size_t* heap;
+    size_t* heap_pos;
+    char* scratch;
+    size_t scratch_cap;
+    stringutils_arena* arena;
+} token_histogram;
+
+/**
+ * This is a block of text that pieces of one or more ropes point in, it gets freed once no piece points in it anymore.
+ * @param refs: number of pieces pointing in data
+ * @param data: the text, <b>NOT</b> NUL terminated
+ */
+typedef struct rope_chunk {
+    size_t refs;
+    char data[];
+} rope_chunk;
+
+/**
+ * This is a node of a rope: a piece of text plus a treap (ordered by position, heap ordered by priority) of the pieces around it.
+ * Shared nodes are never modified, edits copy the O(log n) nodes on their path instead.
+ * @param left: pieces before this one
+ * @param right: pieces after this one
+ * @param chunk: the chunk the piece points in
+ * @param ptr: the piece
+ * @param len: length of the piece
+ * @param total: length of the text of the whole subtree
+ * @param refs: number of parents and ropes pointing to this node
+ * @param priority: random treap priority
+ */
+typedef struct rope_node {
+    struct rope_node* left;
+    struct rope_node* right;
+    rope_chunk* chunk;
+    const char* ptr;
+    size_t len;
+    size_t total;
+    size_t refs;
+    unsigned int priority;
+} rope_node;
+
+/**
+ * This is a string stored as a balanced tree of pieces, for big texts that get edited a lot.
+ * Inserting, erasing and taking a substring are O(log n) and never copy the rest of the text.
+ * Ropes made from one another share their nodes and text, the reference counts aren't atomic so they must stay on one thread.
+ * @param root: the tree, NULL for an empty rope
+ * @see rope_from()
+ */
+typedef struct rope {
+    rope_node* root;
+} rope;
+
+/**
+ * This walks over the pieces of a rope in order, see rope_next().
+ * @param source: the rope, it must not be edited while iterating
+ * @param pos: position of the next byte to hand out
+ */
+typedef struct rope_iter {
+    const rope* source;
+    size_t pos;
+} rope_iter;
+
 // string utility functions
 /**
  * @brief Returns a copy of original string with all whitespace characters removed from both ends of given string.
@@ -179,6 +618,178 @@ char* trimstartnchar(char* string, char* params);
  */
 char* trimstartstr(char* string, char* needle);
 
+/**
+ * @brief Same as trimnchar() but with a precompiled set of characters
+ * <br> trimcs("xyzmy beatiful stringzyy", &cs) -> "my beatiful string" (cs = charset_from("xyz"))
+ * @param original (string to be trimmed)
+ * @param cs (characters to be removed)
+ * @return trimmed (new trimmed string)
+ */
+char* trimcs(char* string, const charset* cs);
+
+/**
+ * @brief Same as trimendnchar() but with a precompiled set of characters
+ * @param original (string to be trimmed)
+ * @param cs (characters to be removed)
+ * @return trimmed (new trimmed string)
+ */
+char* trimendcs(char* string, const charset* cs);
+
+/**
+ * @brief Same as trimstartnchar() but with a precompiled set of characters
+ * @param original (string to be trimmed)
+ * @param cs (characters to be removed)
+ * @return trimmed (new trimmed string)
+ */
+char* trimstartcs(char* string, const charset* cs);
+
+/**
+ * @brief Same as trim() but writes into a buffer owned by the caller, see sv_into().
+ * @param buf (buffer to write into, can be string itself)
+ * @param cap (size of buf)
+ * @param string (string to be trimmed)
+ * @return length of the trimmed string, if it's >= cap the output was truncated
+ */
+long long trim_into(char* buf, size_t cap, char* string);
+
+/**
+ * @brief Same as trimchar() but writes into a buffer owned by the caller, see sv_into().
+ * @param buf (buffer to write into, can be string itself)
+ * @param cap (size of buf)
+ * @param string (string to be trimmed)
+ * @param c (character to remove)
+ * @return length of the trimmed string, if it's >= cap the output was truncated
+ */
+long long trimchar_into(char* buf, size_t cap, char* string, char c);
+
+/**
+ * @brief Same as trimnchar() but writes into a buffer owned by the caller, see sv_into().
+ * @param buf (buffer to write into, can be string itself)
+ * @param cap (size of buf)
+ * @param string (string to be trimmed)
+ * @param params (characters to remove)
+ * @return length of the trimmed string, if it's >= cap the output was truncated
+ */
+long long trimnchar_into(char* buf, size_t cap, char* string, char* params);
+
+/**
+ * @brief Same as trimstr() but writes into a buffer owned by the caller, see sv_into().
+ * @param buf (buffer to write into, can be string itself)
+ * @param cap (size of buf)
+ * @param string (string to be trimmed)
+ * @param needle (string to remove)
+ * @return length of the trimmed string, if it's >= cap the output was truncated
+ */
+long long trimstr_into(char* buf, size_t cap, char* string, char* needle);
+
+/**
+ * @brief Same as trimend() but writes into a buffer owned by the caller, see sv_into().
+ * @param buf (buffer to write into, can be string itself)
+ * @param cap (size of buf)
+ * @param string (string to be trimmed)
+ * @return length of the trimmed string, if it's >= cap the output was truncated
+ */
+long long trimend_into(char* buf, size_t cap, char* string);
+
+/**
+ * @brief Same as trimendchar() but writes into a buffer owned by the caller, see sv_into().
+ * @param buf (buffer to write into, can be string itself)
+ * @param cap (size of buf)
+ * @param string (string to be trimmed)
+ * @param c (character to remove)
+ * @return length of the trimmed string, if it's >= cap the output was truncated
+ */
+long long trimendchar_into(char* buf, size_t cap, char* string, char c);
+
+/**
+ * @brief Same as trimendnchar() but writes into a buffer owned by the caller, see sv_into().
+ * @param buf (buffer to write into, can be string itself)
+ * @param cap (size of buf)
+ * @param string (string to be trimmed)
+ * @param params (characters to remove)
+ * @return length of the trimmed string, if it's >= cap the output was truncated
+ */
+long long trimendnchar_into(char* buf, size_t cap, char* string, char* params);
+
+/**
+ * @brief Same as trimendstr() but writes into a buffer owned by the caller, see sv_into().
+ * @param buf (buffer to write into, can be string itself)
+ * @param cap (size of buf)
+ * @param string (string to be trimmed)
+ * @param needle (string to remove)
+ * @return length of the trimmed string, if it's >= cap the output was truncated
+ */
+long long trimendstr_into(char* buf, size_t cap, char* string, char* needle);
+
+/**
+ * @brief Same as trimstart() but writes into a buffer owned by the caller, see sv_into().
+ * @param buf (buffer to write into, can be string itself)
+ * @param cap (size of buf)
+ * @param string (string to be trimmed)
+ * @return length of the trimmed string, if it's >= cap the output was truncated
+ */
+long long trimstart_into(char* buf, size_t cap, char* string);
+
+/**
+ * @brief Same as trimstartchar() but writes into a buffer owned by the caller, see sv_into().
+ * @param buf (buffer to write into, can be string itself)
+ * @param cap (size of buf)
+ * @param string (string to be trimmed)
+ * @param c (character to remove)
+ * @return length of the trimmed string, if it's >= cap the output was truncated
+ */
+long long trimstartchar_into(char* buf, size_t cap, char* string, char c);
+
+/**
+ * @brief Same as trimstartnchar() but writes into a buffer owned by the caller, see sv_into().
+ * @param buf (buffer to write into, can be string itself)
+ * @param cap (size of buf)
+ * @param string (string to be trimmed)
+ * @param params (characters to remove)
+ * @return length of the trimmed string, if it's >= cap the output was truncated
+ */
+long long trimstartnchar_into(char* buf, size_t cap, char* string, char* params);
+
+/**
+ * @brief Same as trimstartstr() but writes into a buffer owned by the caller, see sv_into().
+ * @param buf (buffer to write into, can be string itself)
+ * @param cap (size of buf)
+ * @param string (string to be trimmed)
+ * @param needle (string to remove)
+ * @return length of the trimmed string, if it's >= cap the output was truncated
+ */
+long long trimstartstr_into(char* buf, size_t cap, char* string, char* needle);
+
+/**
+ * @brief Same as trimcs() but writes into a buffer owned by the caller, see sv_into().
+ * @param buf (buffer to write into, can be string itself)
+ * @param cap (size of buf)
+ * @param string (string to be trimmed)
+ * @param cs (characters to remove)
+ * @return length of the trimmed string, if it's >= cap the output was truncated
+ */
+long long trimcs_into(char* buf, size_t cap, char* string, const charset* cs);
+
+/**
+ * @brief Same as trimendcs() but writes into a buffer owned by the caller, see sv_into().
+ * @param buf (buffer to write into, can be string itself)
+ * @param cap (size of buf)
+ * @param string (string to be trimmed)
+ * @param cs (characters to remove)
+ * @return length of the trimmed string, if it's >= cap the output was truncated
+ */
+long long trimendcs_into(char* buf, size_t cap, char* string, const charset* cs);
+
+/**
+ * @brief Same as trimstartcs() but writes into a buffer owned by the caller, see sv_into().
+ * @param buf (buffer to write into, can be string itself)
+ * @param cap (size of buf)
+ * @param string (string to be trimmed)
+ * @param cs (characters to remove)
+ * @return length of the trimmed string, if it's >= cap the output was truncated
+ */
+long long trimstartcs_into(char* buf, size_t cap, char* string, const charset* cs);
+
 /**
  * @brief Returns a copy of the first n characters of original string
  * <br> strncopy("hello world!", 4) -> "hello"
@@ -199,6 +810,7 @@ char* strcopy(char* orig);
 /**
  * @brief Returns number of times the needle is found in given string
  * <br> count("hello how are you, hello", "hello") -> 2
+ * <br> An empty needle matches at every position, count("abc", "") -> 4
  * @param haystack (string to search in)
  * @param needle (string to be found)
  * @return n of times needle is found in haystack
@@ -216,6 +828,7 @@ int countc(char* haystack, char c);
 
 /**
  * @brief Returns number of times any of the given list of characters is found in given string
+ * <br> Each character of the string is counted at most once, even if it's repeated in params.
  * <br> countnc("hello how are you, hello", "he") -> 6
  * @param haystack (string to search in)
  * @param params (characters to be found)
@@ -223,6 +836,14 @@ int countc(char* haystack, char c);
  */
 int countnc(char* haystack, char* params);
 
+/**
+ * @brief Same as countnc() but with a precompiled set of characters
+ * @param haystack (string to search in)
+ * @param cs (characters to be found)
+ * @return n of times any one of the characters is found in haystack
+ */
+int countcs(char* haystack, const charset* cs);
+
 /**
  * @brief Returns a list of strings, generated by splitting the original string at any whitespace character
  * <br> Stores in (*size) the length of the list
@@ -256,6 +877,15 @@ char** splitc(char* string, char c, int* size);
  */
 char** splitnc(char* string, char* params, int* size);
 
+/**
+ * @brief Same as splitnc() but with a precompiled set of characters
+ * @param string (string to be split)
+ * @param cs (characters to split at)
+ * @param size (gets set by the function, returns length of list)
+ * @return list of strings
+ */
+char** splitcs(char* string, const charset* cs, int* size);
+
 /**
  * @brief Returns a list of strings, generated by splitting the original string at another string
  * <br> Stores in (*size) the length of the list
@@ -357,6 +987,24 @@ int rfind(char* haystack, char* needle);
  */
 int rfindc(char* haystack, char needle);
 
+/**
+ * @brief Returns the first index of any of the characters of given set in given string
+ * <br> findcs("hello, world!", &cs) -> 5 (cs = charset_from(",!"))
+ * @param haystack (string to check)
+ * @param cs (characters to find)
+ * @return first index of occurrence, else -1
+ */
+int findcs(char* haystack, const charset* cs);
+
+/**
+ * @brief Returns the last index of any of the characters of given set in given string
+ * <br> rfindcs("hello, world!", &cs) -> 12 (cs = charset_from(",!"))
+ * @param haystack (string to check)
+ * @param cs (characters to find)
+ * @return last index of occurrence, else -1
+ */
+int rfindcs(char* haystack, const charset* cs);
+
 /**
  * @brief Concatenates 2 strings together into a new string.
  * <br> sum("hello", "world") -> "helloworld"
@@ -375,6 +1023,43 @@ char* sum(char* first, char* second);
  */
 char* sub(char* haystack, char needle);
 
+/**
+ * @brief Same as sub() but writes into a buffer owned by the caller, like replace_into().
+ * @param buf (buffer to write into, can be haystack itself to remove the character in place)
+ * @param cap (size of buf)
+ * @param haystack (original string)
+ * @param needle (character to remove)
+ * @return length of the whole result, if it's >= cap the output was truncated
+ */
+long long sub_into(char* buf, size_t cap, char* haystack, char needle);
+
+/**
+ * @brief Returns a new string without any of the given characters, like sub() for several characters at once
+ * <br> removenc("{ \"a\": 1 }", " \n\t") -> "{\"a\":1}"
+ * @param string (original string)
+ * @param params (characters to remove)
+ * @return string without those characters
+ */
+char* removenc(char* string, char* params);
+
+/**
+ * @brief Same as removenc() with a charset built by charset_from()
+ * @param string (original string)
+ * @param cs (characters to remove)
+ * @return string without those characters
+ */
+char* removecs(char* string, const charset* cs);
+
+/**
+ * @brief Same as removecs() but writes into a buffer owned by the caller, like replace_into().
+ * @param buf (buffer to write into, can be string itself to remove the characters in place)
+ * @param cap (size of buf)
+ * @param string (original string)
+ * @param cs (characters to remove)
+ * @return length of the whole result, if it's >= cap the output was truncated
+ */
+long long removecs_into(char* buf, size_t cap, char* string, const charset* cs);
+
 /**
  * @brief Returns new string with original string concatenated with specified character
  * <br> append("hello world", '!') -> "hello world!"
@@ -385,7 +1070,7 @@ char* sub(char* haystack, char needle);
 char* append(char* first, char second);
 
 /**
- * @brief Returns a new string with all characters to be uppercase
+ * @brief Returns a new string with all characters to be uppercase, only ASCII letters are changed (whatever the locale)
  * <br> toupperstr("make me big") -> "MAKE ME BIG"
  * @param string (to be capitalized)
  * @return string with all uppercase characters
@@ -393,13 +1078,91 @@ char* append(char* first, char second);
 char* toupperstr(char* string);
 
 /**
- * @brief Returns a new string with all characters to be lowercase
+ * @brief Same as toupperstr() but writes into a buffer owned by the caller, like replace_into().
+ * @param buf (buffer to write into, can be string itself to convert it in place)
+ * @param cap (size of buf)
+ * @param string (to be uppercased)
+ * @return length of the string, if it's >= cap the output was truncated
+ */
+long long toupperstr_into(char* buf, size_t cap, char* string);
+
+/**
+ * @brief Returns a new string with all characters to be lowercase, only ASCII letters are changed (whatever the locale)
  * <br> tolowerstr("MAKE ME SMALL") -> "make me small"
  * @param string (to be lowercased)
  * @return string with all lowercase characters
  */
 char* tolowerstr(char* string);
 
+/**
+ * @brief Same as tolowerstr() but writes into a buffer owned by the caller, like replace_into().
+ * @param buf (buffer to write into, can be string itself to convert it in place)
+ * @param cap (size of buf)
+ * @param string (to be lowercased)
+ * @return length of the string, if it's >= cap the output was truncated
+ */
+long long tolowerstr_into(char* buf, size_t cap, char* string);
+
+/**
+ * @brief Same as toupperstr() but goes through toupper(), so characters outside of ASCII follow the current locale.
+ * @param string (to be capitalized)
+ * @return string with all uppercase characters
+ */
+char* toupperstr_locale(char* string);
+
+/**
+ * @brief Same as tolowerstr() but goes through tolower(), so characters outside of ASCII follow the current locale.
+ * @param string (to be lowercased)
+ * @return string with all lowercase characters
+ */
+char* tolowerstr_locale(char* string);
+
+/**
+ * @brief Case insensitive find(), ASCII letters match regardless of case. Nothing gets copied.
+ * <br> ifind("Content-Type: text/html", "TYPE") -> 8
+ * @param haystack (string to check)
+ * @param needle (string to find)
+ * @return first index of occurrence, else -1
+ */
+int ifind(char* haystack, char* needle);
+
+/**
+ * @brief Case insensitive count(), ASCII letters match regardless of case
+ * <br> icount("Abc aBC abc", "abc") -> 3
+ * @param haystack (string to search in)
+ * @param needle (string to be found)
+ * @return n of times needle is found in haystack
+ */
+int icount(char* haystack, char* needle);
+
+/**
+ * @brief Case insensitive startswith(), ASCII letters match regardless of case
+ * <br> istartswith("Content-Length: 10", "content-length:") -> 1
+ * @param haystack (string to check)
+ * @param needle (string that haystack has to start with)
+ * @return 1 if true, 0 if false
+ */
+int istartswith(char* haystack, char* needle);
+
+/**
+ * @brief Case insensitive endswith(), ASCII letters match regardless of case
+ * <br> iendswith("index.HTML", ".html") -> 1
+ * @param haystack (string to check)
+ * @param needle (string that haystack has to end with)
+ * @return 1 if true, 0 if false
+ */
+int iendswith(char* haystack, char* needle);
+
+/**
+ * @brief Case insensitive replace(), every occurrence of needle is replaced regardless of case
+ * <br> ireplace("Hello HELLO hello", "hello", "bye") -> "bye bye bye"
+ * @param orig (string to do replacements in)
+ * @param needle (string to replace)
+ * @param rep (string to replace needle with)
+ * @return string with the replacements
+ */
+char* ireplace(char* orig, char* needle, char* rep);
+
 /**
  * @brief Returns a "zipped" string, basically removes all adjacent repeated whitespace to 1 occurrence
  * <br> Whitespace includes: space, newline, carriage return, tab
@@ -409,8 +1172,18 @@ char* tolowerstr(char* string);
  */
 char* zip_string(char* string);
 
+/**
+ * @brief Same as zip_string() but writes into a buffer owned by the caller, like replace_into().
+ * @param buf (buffer to write into, can be string itself to zip it in place)
+ * @param cap (size of buf)
+ * @param string
+ * @return length of the zipped string, if it's >= cap the output was truncated
+ */
+long long zip_string_into(char* buf, size_t cap, char* string);
+
 /**
  * @brief Replaces all occurrences of specified needle with specified rep in given original string, returns a new string, doesn't modify in-place.
+ * <br> Occurrences are replaced left to right and never overlap, an empty needle replaces nothing.
  * <br> replace("hello,world,!", ",", "test") -> "hellotestworldtest!"
  * @param orig (string to search into)
  * @param needle (string to find)
@@ -419,6 +1192,19 @@ char* zip_string(char* string);
  */
 char* replace(char* orig, char* needle, char* rep);
 
+/**
+ * @brief Same as replace() but writes into a buffer owned by the caller, like snprintf().
+ * <br> At most cap-1 characters are written and the result is always NUL terminated (if cap > 0).
+ * <br> replace_into(buf, 64, "hello,world,!", ",", "test") -> 19, buf = "hellotestworldtest!"
+ * @param buf (buffer to write into)
+ * @param cap (size of buf)
+ * @param orig (string to search into)
+ * @param needle (string to find)
+ * @param rep (string to replace with)
+ * @return length of the whole result, if it's >= cap the output was truncated
+ */
+long long replace_into(char* buf, size_t cap, char* orig, char* needle, char* rep);
+
 /**
  * @brief Replaces all occurrences of specified needle with specified rep in given original string, returns a new string, doesn't modify in-place.
  * <br> replacec("hello*world*!", '*', ' ') -> "hello world !"
@@ -429,6 +1215,17 @@ char* replace(char* orig, char* needle, char* rep);
  */
 char* replacec(char* orig, char needle, char rep);
 
+/**
+ * @brief Same as replacec() but writes into a buffer owned by the caller, like replace_into().
+ * @param buf (buffer to write into, can be orig itself to replace in place)
+ * @param cap (size of buf)
+ * @param orig (string to search into)
+ * @param needle (character to find)
+ * @param rep (character to replace with)
+ * @return length of the string, if it's >= cap the output was truncated
+ */
+long long replacec_into(char* buf, size_t cap, char* orig, char needle, char rep);
+
 /**
  * @brief Returns a new string which is a substring of original, equivalent to [start:end] in Python.
  * If end is -1, it'll be equivalent to  [start:].
@@ -443,55 +1240,1377 @@ char* replacec(char* orig, char needle, char rep);
  */
 char* substr(char* orig, int start, int end);
 
-// allocation utility functions
 /**
- * @brief Allocates a generic void** pointer of size*count bytes. Size and count are given by the user.
- * <br>void** ptr = safe_alloc_generic(10, 2)
- * @warning <b>THIS DOES NOT GET FREED by free_all_stringutils_structures(), it's up to the caller to free this memory</b>
- * @param size
- * @param count
- * @return an allocated void** pointer of given size and count
- * @see free_all_stringutils_structures()
+ * @brief Same as substr() but writes into a buffer owned by the caller, see sv_into().
+ * @param buf (buffer to write into, can be orig itself)
+ * @param cap (size of buf)
+ * @param orig (the string to grab the substring from)
+ * @param start (starting index, -1 to be from start always)
+ * @param end (ending index, -1 to go to end always)
+ * @return length of the substring, if it's >= cap the output was truncated
  */
-void** safe_alloc_generic(size_t size, size_t count);
+long long substr_into(char* buf, size_t cap, char* orig, int start, int end);
 
+// batch functions
 /**
- * @brief Allocates a generic char* pointer of given size (size DOESN'T NEED to account for string terminator)
- * <br> This DOES get freed by free_all_stringutils_structures(), so you don't need to manually free this memory if you call it
- * <br> char* str = alloc_safe_str(strlen("this is a test"))
- * @see free_all_stringutils_structures()
- * @param size
- * @return allocated char* pointer
+ * @brief Trims every string of a list, like trim(), storing all results in one allocation.
+ * <br> The allocation gets freed by free_all_stringutils_structures() (or lives in the arena in use), like any other string.
+ * <br> trim_batch({" a ", "b  "}, 2) -> data = "a\0b\0", offsets = {0, 2, 4}
+ * @param strings (list of strings)
+ * @param n (length of the list)
+ * @return the results
+ * @see free_batch()
  */
-char* alloc_safe_str(size_t size);
+strbatch trim_batch(char** strings, int n);
 
-// library functions
 /**
- * @brief This functions frees each and every string/every list of strings allocated by any function of this header.
- * <br> This is to facilitate memory management, since you just need to call this function at the end of whatever you want.
- * <br> Please do note that if this was compiled with GCC this function will be called automatically at program exit if possible.
- * <br> So make sure to know what you're doing if you call this manually!
+ * @brief Same as trim_batch() but for trimchar()
+ * @param strings (list of strings)
+ * @param n (length of the list)
+ * @param c (character to remove)
+ * @return the results
  */
-void free_all_stringutils_structures();
+strbatch trimchar_batch(char** strings, int n, char c);
 
 /**
- * @brief Exposes internal list of all currently allocated strings. Use with caution, as this has no guarantees.
- * <br> If you free any string from this, make sure to also modify the .contains parameter.
- * @return pointer to internal struct of strings
+ * @brief Same as trim_batch() but for trimnchar()
+ * @param strings (list of strings)
+ * @param n (length of the list)
+ * @param params (characters to remove)
+ * @return the results
  */
-alloced_strings* expose_internal_strings();
+strbatch trimnchar_batch(char** strings, int n, char* params);
 
 /**
- * @brief Exposes internal list of all currently allocated lists of strings. Use with caution, as this has no guarantees.
- * <br> If you free any list from this, make sure to also modify the .contains parameter.
- * Also, also make sure to free the strings of said list from the internal strings first.
- * @return pointer to internal struct of list of strings
+ * @brief Same as trim_batch() but for toupperstr()
+ * @param strings (list of strings)
+ * @param n (length of the list)
+ * @return the results
  */
-alloced_vects* expose_internal_vectors();
+strbatch toupperstr_batch(char** strings, int n);
+
+/**
+ * @brief Same as trim_batch() but for tolowerstr()
+ * @param strings (list of strings)
+ * @param n (length of the list)
+ * @return the results
+ */
+strbatch tolowerstr_batch(char** strings, int n);
+
+/**
+ * @brief Same as trim_batch() but for replacec()
+ * @param strings (list of strings)
+ * @param n (length of the list)
+ * @param needle (character to find)
+ * @param rep (character to replace with)
+ * @return the results
+ */
+strbatch replacec_batch(char** strings, int n, char needle, char rep);
+
+/**
+ * @brief Same as trim_batch() but for replace()
+ * @param strings (list of strings)
+ * @param n (length of the list)
+ * @param needle (string to find)
+ * @param rep (string to replace with)
+ * @return the results
+ */
+strbatch replace_batch(char** strings, int n, char* needle, char* rep);
+
+/**
+ * @brief Same as trim_batch() but for zip_string()
+ * @param strings (list of strings)
+ * @param n (length of the list)
+ * @return the results
+ */
+strbatch zip_string_batch(char** strings, int n);
+
+/**
+ * @brief Same as trim_batch() but for sub()
+ * @param strings (list of strings)
+ * @param n (length of the list)
+ * @param needle (character to remove)
+ * @return the results
+ */
+strbatch sub_batch(char** strings, int n, char needle);
+
+/**
+ * @brief Frees the results of a batch function right away, see free_string()
+ * @param batch
+ */
+void free_batch(strbatch* batch);
+
+// charset functions
+/**
+ * @brief Builds a set from all the characters of given string
+ * <br> charset cs = charset_from("\t\r\n ")
+ * @param params (string contaning all the characters of the set)
+ * @return the set
+ */
+charset charset_from(const char* params);
+
+/**
+ * @brief Checks if given character belongs to given set
+ * @param cs
+ * @param c
+ * @return 1 if true, 0 if false
+ */
+int charset_contains(const charset* cs, char c);
+
+/**
+ * @brief View equivalent of trimcs(), no allocation is made.
+ * @param view (view to be trimmed)
+ * @param cs (characters to be removed)
+ * @return trimmed view
+ */
+strview sv_trimcs(strview view, const charset* cs);
+
+/**
+ * @brief View equivalent of trimendcs(), no allocation is made.
+ * @param view (view to be trimmed)
+ * @param cs (characters to be removed)
+ * @return trimmed view
+ */
+strview sv_trimendcs(strview view, const charset* cs);
+
+/**
+ * @brief View equivalent of trimstartcs(), no allocation is made.
+ * @param view (view to be trimmed)
+ * @param cs (characters to be removed)
+ * @return trimmed view
+ */
+strview sv_trimstartcs(strview view, const charset* cs);
+
+/**
+ * @brief View equivalent of findcs()
+ * @param haystack (view to check)
+ * @param cs (characters to find)
+ * @return first index of occurrence, else -1
+ */
+long long sv_findcs(strview haystack, const charset* cs);
+
+/**
+ * @brief View equivalent of rfindcs()
+ * @param haystack (view to check)
+ * @param cs (characters to find)
+ * @return last index of occurrence, else -1
+ */
+long long sv_rfindcs(strview haystack, const charset* cs);
+
+/**
+ * @brief View equivalent of countcs()
+ * @param haystack (view to search in)
+ * @param cs (characters to be found)
+ * @return n of times any one of the characters is found in haystack
+ */
+long long sv_countcs(strview haystack, const charset* cs);
+
+/**
+ * @brief Zero-copy iterator equivalent of splitcs()
+ * @param rest (what's left to split, gets updated by the function)
+ * @param cs (characters to split at)
+ * @param token (gets set by the function)
+ * @return 1 if a token was stored, 0 when there are no more
+ * @see sv_split_next()
+ */
+int sv_splitcs_next(strview* rest, const charset* cs, strview* token);
+
+// string view functions
+/**
+ * @brief Returns a view over the whole given string, the length is computed once here.
+ * <br> sv_from("hello") -> {"hello", 5}
+ * @param string
+ * @return view over string
+ */
+strview sv_from(const char* string);
+
+/**
+ * @brief Returns a view over the first len bytes of given buffer, the buffer doesn't need to be NUL terminated.
+ * <br> sv_fromn("hello world", 5) -> {"hello", 5}
+ * @param string
+ * @param len (number of bytes in the view)
+ * @return view over string
+ */
+strview sv_fromn(const char* string, size_t len);
+
+/**
+ * @brief Returns a new NUL terminated copy of given view, allocated like any other string of this library.
+ * <br> sv_tostr(sv_fromn("hello world", 5)) -> "hello"
+ * @param view
+ * @return string
+ */
+char* sv_tostr(strview view);
+
+/**
+ * @brief Copies a view into a buffer owned by the caller, like snprintf(). No allocation is made.
+ * <br> At most cap-1 characters are written and the result is always NUL terminated (if cap > 0).
+ * <br> The view can point inside buf, so this also works to edit a string in place: sv_into(s, strlen(s)+1, sv_trim(sv_from(s)))
+ * @param buf (buffer to write into)
+ * @param cap (size of buf)
+ * @param view (view to copy)
+ * @return length of the view, if it's >= cap the output was truncated
+ */
+long long sv_into(char* buf, size_t cap, strview view);
+
+/**
+ * @brief Checks if 2 views hold the same bytes
+ * <br> sv_equals(sv_from("abc"), sv_fromn("abcd", 3)) -> 1
+ * @param first
+ * @param second
+ * @return 1 if true, 0 if false
+ */
+int sv_equals(strview first, strview second);
+
+/**
+ * @brief View equivalent of trim(), no allocation is made.
+ * <br> sv_trim(sv_from("  my beatiful string   ")) -> {"my beatiful string", 18}
+ * @param view (view to be trimmed)
+ * @return trimmed view
+ * @see trim()
+ */
+strview sv_trim(strview view);
+
+/**
+ * @brief View equivalent of trimchar(), no allocation is made.
+ * @param view (view to be trimmed)
+ * @param c (character to remove)
+ * @return trimmed view
+ * @see trimchar()
+ */
+strview sv_trimchar(strview view, char c);
+
+/**
+ * @brief View equivalent of trimnchar(), no allocation is made.
+ * @param view (view to be trimmed)
+ * @param params (string contaning all the characters to be removed)
+ * @return trimmed view
+ * @see trimnchar()
+ */
+strview sv_trimnchar(strview view, const char* params);
+
+/**
+ * @brief View equivalent of trimstr(), no allocation is made.
+ * @param view (view to be trimmed)
+ * @param needle (string to trim from view)
+ * @return trimmed view
+ * @see trimstr()
+ */
+strview sv_trimstr(strview view, strview needle);
+
+/**
+ * @brief View equivalent of trimend(), no allocation is made.
+ * @param view (view to be trimmed)
+ * @return trimmed view
+ * @see trimend()
+ */
+strview sv_trimend(strview view);
+
+/**
+ * @brief View equivalent of trimendchar(), no allocation is made.
+ * @param view (view to be trimmed)
+ * @param c (character to remove)
+ * @return trimmed view
+ * @see trimendchar()
+ */
+strview sv_trimendchar(strview view, char c);
+
+/**
+ * @brief View equivalent of trimendnchar(), no allocation is made.
+ * @param view (view to be trimmed)
+ * @param params (string contaning all the characters to be removed)
+ * @return trimmed view
+ * @see trimendnchar()
+ */
+strview sv_trimendnchar(strview view, const char* params);
+
+/**
+ * @brief View equivalent of trimendstr(), no allocation is made.
+ * @param view (view to be trimmed)
+ * @param needle (string to trim from view)
+ * @return trimmed view
+ * @see trimendstr()
+ */
+strview sv_trimendstr(strview view, strview needle);
+
+/**
+ * @brief View equivalent of trimstart(), no allocation is made.
+ * @param view (view to be trimmed)
+ * @return trimmed view
+ * @see trimstart()
+ */
+strview sv_trimstart(strview view);
+
+/**
+ * @brief View equivalent of trimstartchar(), no allocation is made.
+ * @param view (view to be trimmed)
+ * @param c (character to remove)
+ * @return trimmed view
+ * @see trimstartchar()
+ */
+strview sv_trimstartchar(strview view, char c);
+
+/**
+ * @brief View equivalent of trimstartnchar(), no allocation is made.
+ * @param view (view to be trimmed)
+ * @param params (string contaning all the characters to be removed)
+ * @return trimmed view
+ * @see trimstartnchar()
+ */
+strview sv_trimstartnchar(strview view, const char* params);
+
+/**
+ * @brief View equivalent of trimstartstr(), no allocation is made.
+ * @param view (view to be trimmed)
+ * @param needle (string to trim from view)
+ * @return trimmed view
+ * @see trimstartstr()
+ */
+strview sv_trimstartstr(strview view, strview needle);
+
+/**
+ * @brief Returns the [start:end] part of given view, indexes past the end are clamped to the length of the view.
+ * <br> sv_substr(sv_from("hello world"), 6, 11) -> {"world", 5}
+ * @param view
+ * @param start (starting index)
+ * @param end (ending index, excluded)
+ * @return view over the range
+ */
+strview sv_substr(strview view, size_t start, size_t end);
+
+/**
+ * @brief View equivalent of startswith()
+ * @param haystack (view to check)
+ * @param needle (view that haystack has to start with)
+ * @return 1 if true, 0 if false
+ */
+int sv_startswith(strview haystack, strview needle);
+
+/**
+ * @brief View equivalent of endswith()
+ * @param haystack (view to check)
+ * @param needle (view that haystack has to end with)
+ * @return 1 if true, 0 if false
+ */
+int sv_endswith(strview haystack, strview needle);
+
+/**
+ * @brief View equivalent of find()
+ * @param haystack (view to check)
+ * @param needle (view to find)
+ * @return first index of occurrence, else -1
+ */
+long long sv_find(strview haystack, strview needle);
+
+/**
+ * @brief View equivalent of rfind()
+ * @param haystack (view to check)
+ * @param needle (view to find)
+ * @return last index of occurrence, else -1
+ */
+long long sv_rfind(strview haystack, strview needle);
+
+/**
+ * @brief View equivalent of findc()
+ * @param haystack (view to check)
+ * @param needle (character to find)
+ * @return first index of occurrence, else -1
+ */
+long long sv_findc(strview haystack, char needle);
+
+/**
+ * @brief View equivalent of rfindc()
+ * @param haystack (view to check)
+ * @param needle (character to find)
+ * @return last index of occurrence, else -1
+ */
+long long sv_rfindc(strview haystack, char needle);
+
+/**
+ * @brief Returns the first index of any of the given characters in given view
+ * <br> sv_findnc(sv_from("hello, world!"), ",!") -> 5
+ * @param haystack (view to check)
+ * @param params (characters to find)
+ * @return first index of occurrence, else -1
+ */
+long long sv_findnc(strview haystack, const char* params);
+
+/**
+ * @brief Returns the last index of any of the given characters in given view
+ * <br> sv_rfindnc(sv_from("hello, world!"), ",!") -> 12
+ * @param haystack (view to check)
+ * @param params (characters to find)
+ * @return last index of occurrence, else -1
+ */
+long long sv_rfindnc(strview haystack, const char* params);
+
+/**
+ * @brief View equivalent of count(), an empty needle also gives haystack.len + 1
+ * @param haystack (view to search in)
+ * @param needle (view to be found)
+ * @return n of times needle is found in haystack
+ */
+long long sv_count(strview haystack, strview needle);
+
+/**
+ * @brief View equivalent of ifind()
+ * @param haystack (view to check)
+ * @param needle (view to find)
+ * @return first index of occurrence, else -1
+ */
+long long sv_ifind(strview haystack, strview needle);
+
+/**
+ * @brief View equivalent of icount()
+ * @param haystack (view to search in)
+ * @param needle (view to be found)
+ * @return n of times needle is found in haystack
+ */
+long long sv_icount(strview haystack, strview needle);
+
+/**
+ * @brief View equivalent of istartswith()
+ * @param haystack (view to check)
+ * @param needle (view that haystack has to start with)
+ * @return 1 if true, 0 if false
+ */
+int sv_istartswith(strview haystack, strview needle);
+
+/**
+ * @brief View equivalent of iendswith()
+ * @param haystack (view to check)
+ * @param needle (view that haystack has to end with)
+ * @return 1 if true, 0 if false
+ */
+int sv_iendswith(strview haystack, strview needle);
+
+/**
+ * @brief View equivalent of countc()
+ * @param haystack (view to search in)
+ * @param c (character to be found)
+ * @return n of times character is found in haystack
+ */
+long long sv_countc(strview haystack, char c);
+
+/**
+ * @brief Zero-copy iterator equivalent of split(), every call stores the next token in (*token) and advances (*rest) past it.
+ * <br> strview rest = sv_from("this is a string"), token;
+ * <br> while (sv_split_next(&rest, &token)) { ... } -> "this", "is", "a", "string"
+ * @param rest (what's left to split, gets updated by the function)
+ * @param token (gets set by the function)
+ * @return 1 if a token was stored, 0 when there are no more
+ * @see split()
+ */
+int sv_split_next(strview* rest, strview* token);
+
+/**
+ * @brief Zero-copy iterator equivalent of splitc()
+ * @param rest (what's left to split, gets updated by the function)
+ * @param c (character to split at)
+ * @param token (gets set by the function)
+ * @return 1 if a token was stored, 0 when there are no more
+ * @see sv_split_next()
+ */
+int sv_splitc_next(strview* rest, char c, strview* token);
+
+/**
+ * @brief Zero-copy iterator equivalent of splitnc(), the set gets rebuilt on every call so prefer sv_splitcs_next() in loops.
+ * @param rest (what's left to split, gets updated by the function)
+ * @param params (characters to split at)
+ * @param token (gets set by the function)
+ * @return 1 if a token was stored, 0 when there are no more
+ * @see sv_split_next()
+ */
+int sv_splitnc_next(strview* rest, const char* params, strview* token);
+
+/**
+ * @brief Zero-copy iterator equivalent of splitstr()
+ * @param rest (what's left to split, gets updated by the function)
+ * @param needle (view to split at)
+ * @param token (gets set by the function)
+ * @return 1 if a token was stored, 0 when there are no more
+ * @see sv_split_next()
+ */
+int sv_splitstr_next(strview* rest, strview needle, strview* token);
+
+// compiled needle functions
+/**
+ * @brief Preprocesses a needle once so that it can be searched for many times.
+ * <br> compiled_needle* needle = compile_needle("pebble")
+ * @warning <b>THIS DOES NOT GET FREED by free_all_stringutils_structures(), free it with free_needle()</b>
+ * @param needle (string to be found)
+ * @return compiled needle, holding its own copy of needle
+ * @see free_needle()
+ */
+compiled_needle* compile_needle(char* needle);
+
+/**
+ * @brief Equivalent of sv_find() with a compiled needle
+ * <br> find_compiled(sv_from("this string contains pebble, it does!"), needle) -> 21
+ * @param haystack (view to check)
+ * @param needle (compiled needle to find)
+ * @return first index of occurrence, else -1
+ */
+long long find_compiled(strview haystack, const compiled_needle* needle);
+
+/**
+ * @brief Equivalent of sv_rfind() with a compiled needle
+ * @param haystack (view to check)
+ * @param needle (compiled needle to find)
+ * @return last index of occurrence, else -1
+ */
+long long rfind_compiled(strview haystack, const compiled_needle* needle);
+
+/**
+ * @brief Equivalent of sv_count() with a compiled needle, overlapping occurrences are counted too.
+ * @param haystack (view to search in)
+ * @param needle (compiled needle to be found)
+ * @return n of times needle is found in haystack
+ */
+long long count_compiled(strview haystack, const compiled_needle* needle);
+
+/**
+ * @brief Frees a needle made by compile_needle()
+ * @param needle
+ */
+void free_needle(compiled_needle* needle);
+
+// multi pattern functions
+/**
+ * @brief Compiles a list of patterns into a single automaton, empty patterns are ignored.
+ * <br> multi_pattern* mp = compile_patterns((char*[]){"he", "she", "hers"}, 3)
+ * @warning <b>THIS DOES NOT GET FREED by free_all_stringutils_structures(), free it with free_patterns()</b>
+ * @param patterns (list of strings to be found)
+ * @param n (length of the list)
+ * @return compiled patterns
+ * @see free_patterns()
+ */
+multi_pattern* compile_patterns(char** patterns, int n);
+
+/**
+ * @brief Finds the first occurrence (the one that ends first, the longest one if more end at the same index) of any of the patterns.
+ * <br> find_any(sv_from("ushers"), mp, &which) -> 1 (which = 1, "she")
+ * @param haystack (view to check)
+ * @param patterns (compiled patterns to find)
+ * @param which (gets set by the function to the index of the pattern found, can be NULL)
+ * @return index of occurrence, else -1
+ */
+long long find_any(strview haystack, const multi_pattern* patterns, int* which);
+
+/**
+ * @brief Counts the occurrences of each pattern, overlapping occurrences are counted too.
+ * <br> count_each(sv_from("ushers"), mp, counts) -> counts = {1, 1, 1}
+ * @param haystack (view to search in)
+ * @param patterns (compiled patterns to be found)
+ * @param counts (gets set by the function, must hold patterns->patterns elements)
+ */
+void count_each(strview haystack, const multi_pattern* patterns, long long* counts);
+
+/**
+ * @brief Replaces the occurrences of every pattern with the matching entry of reps in a single pass, returns a new string.
+ * <br> Occurrences are picked in the order in which they end, the longest one if more end at the same index, skipping any that overlaps the previous one.
+ * <br> replace_many("ushers", mp, (char*[]){"1", "2", "3"}) -> "u2rs"
+ * @param orig (string to search into)
+ * @param patterns (compiled patterns to find)
+ * @param reps (list of strings to replace with, one for each pattern)
+ * @return string with all patterns replaced
+ */
+char* replace_many(char* orig, const multi_pattern* patterns, char** reps);
+
+/**
+ * @brief Frees patterns made by compile_patterns()
+ * @param patterns
+ */
+void free_patterns(multi_pattern* patterns);
+
+// glob functions
+/**
+ * @brief Compiles a glob pattern, the whole text has to match it. Supported syntax:
+ * <br> '*' matches any sequence of bytes, '?' any single byte, "[abc]", "[a-z]" a byte in the class, "[!a-z]" or "[^a-z]" one that isn't
+ * <br> '\\' makes the next byte (also inside classes) match only itself, a ']' right after the opening '[' is part of the class
+ * <br> Without wildcards a pattern works like an equality check, "abc*" like startswith() and "*.png" like endswith()
+ * <br> glob_pattern* g = compile_glob("/api/v?/[a-z]*", GlobPathname)
+ * @warning <b>THIS DOES NOT GET FREED by free_all_stringutils_structures(), free it with free_glob()</b>
+ * @warning Patterns with an unterminated class, a trailing '\\' or more than 4095 items raise InvalidPattern and return NULL
+ * @param pattern (glob to compile)
+ * @param flags (StringUtilsGlobFlags combined with |)
+ * @return compiled pattern
+ * @see StringUtilsGlobFlags
+ * @see free_glob()
+ */
+glob_pattern* compile_glob(const char* pattern, int flags);
+
+/**
+ * @brief Checks if a whole view matches a compiled glob.
+ * <br> match_glob(sv_from("/api/v2/users"), g) -> 1
+ * @param text (view to check)
+ * @param glob (compiled pattern)
+ * @return 1 if it matches, else 0
+ */
+int match_glob(strview text, const glob_pattern* glob);
+
+/**
+ * @brief Checks a whole list of strings against a compiled glob.
+ * <br> match_many((char*[]){"/api/v1/x", "/img/a.png", "/api/v3/y"}, 3, g, results) -> 2 (results = {1, 0, 1})
+ * @param strings (list of strings to check, NULL entries never match)
+ * @param n (length of the list)
+ * @param glob (compiled pattern)
+ * @param results (gets set by the function to 1 or 0 for each string, can be NULL)
+ * @return number of strings that match
+ */
+int match_many(char** strings, int n, const glob_pattern* glob, int* results);
+
+/**
+ * @brief Frees a pattern made by compile_glob()
+ * @param glob
+ */
+void free_glob(glob_pattern* glob);
+
+// numeric functions
+/**
+ * @brief Parses a whole view as a base 10 integer, the same way whatever the locale.
+ * <br> A sign is allowed and whitespace (see trim()) around the number is ignored, anything else makes the view invalid.
+ * <br> sv_parse_ll(sv_from(" -42\r"), &n) -> 1 (n = -42)
+ * @param sv (view to parse)
+ * @param out (gets set by the function to the number, left untouched if the view is invalid)
+ * @return 1 if the view holds a number that fits a long long, else 0
+ */
+int sv_parse_ll(strview sv, long long* out);
+
+/**
+ * @brief Parses a whole view as a decimal floating point number, rounded to the nearest double. The decimal point is always '.', whatever the locale.
+ * <br> Accepted forms are "12", "-1.5", ".5", "3.", "6.02e23", "1E-9", plus "inf", "infinity" and "nan" in any case, with whitespace around them ignored.
+ * <br> Numbers too big for a double become inf and too small ones 0, like strtod() does.
+ * <br> sv_parse_double(sv_from("2.5e-3"), &d) -> 1 (d = 0.0025)
+ * @param sv (view to parse)
+ * @param out (gets set by the function to the number, left untouched if the view is invalid)
+ * @return 1 if the view holds a number, else 0
+ */
+int sv_parse_double(strview sv, double* out);
+
+/**
+ * @brief Parses every field of a column like sv_parse_ll(), for instance the list returned by splitc().
+ * <br> parse_column_ll((char*[]){"1", " 2", "x"}, 3, out, valid) -> 2 (out = {1, 2, 0}, valid = {1, 1, 0})
+ * @param fields (list of strings to parse, NULL entries are invalid)
+ * @param n (length of the list)
+ * @param out (gets set by the function, must hold n elements, invalid fields are set to 0)
+ * @param valid (gets set by the function to 1 or 0 for each field, can be NULL)
+ * @return number of valid fields
+ */
+int parse_column_ll(char** fields, int n, long long* out, int* valid);
+
+/**
+ * @brief Parses every field of a column like sv_parse_double(), for instance the list returned by splitc().
+ * <br> parse_column_double((char*[]){"1.5", "-2", ""}, 3, out, valid) -> 2 (out = {1.5, -2.0, 0.0}, valid = {1, 1, 0})
+ * @param fields (list of strings to parse, NULL entries are invalid)
+ * @param n (length of the list)
+ * @param out (gets set by the function, must hold n elements, invalid fields are set to 0)
+ * @param valid (gets set by the function to 1 or 0 for each field, can be NULL)
+ * @return number of valid fields
+ */
+int parse_column_double(char** fields, int n, double* out, int* valid);
+
+/**
+ * @brief Same as parse_column_ll() but for a list of views, like the fields filled by sv_splitc_into().
+ * @param fields (list of views to parse)
+ * @param n (length of the list)
+ * @param out (gets set by the function, must hold n elements, invalid fields are set to 0)
+ * @param valid (gets set by the function to 1 or 0 for each field, can be NULL)
+ * @return number of valid fields
+ */
+int sv_parse_column_ll(const strview* fields, int n, long long* out, int* valid);
+
+/**
+ * @brief Same as parse_column_double() but for a list of views, like the fields filled by sv_splitc_into().
+ * @param fields (list of views to parse)
+ * @param n (length of the list)
+ * @param out (gets set by the function, must hold n elements, invalid fields are set to 0)
+ * @param valid (gets set by the function to 1 or 0 for each field, can be NULL)
+ * @return number of valid fields
+ */
+int sv_parse_column_double(const strview* fields, int n, double* out, int* valid);
+
+/**
+ * @brief Returns the shortest decimal form of a double that sv_parse_double() (or strtod()) reads back as the same number.
+ * <br> Plain notation is used when the exponent is between -7 and 21 (exclusive), scientific notation otherwise, the decimal point is always '.'.
+ * <br> format_double(0.1) -> "0.1", format_double(1e21) -> "1e+21", format_double(-1.0/3) -> "-0.3333333333333333"
+ * @param x (number to format)
+ * @return formatted number
+ */
+char* format_double(double x);
+
+/**
+ * @brief Same as format_double() but writes into a buffer owned by the caller, see sv_into(). The result is never longer than 25 characters.
+ * @param buf (buffer to write into)
+ * @param cap (size of buf)
+ * @param x (number to format)
+ * @return length of the formatted number, if it's >= cap the output was truncated
+ */
+long long format_double_into(char* buf, size_t cap, double x);
+
+// streaming functions
+/**
+ * @brief Separator for tokenizers that splits at any whitespace and skips empty tokens, like split()
+ * @return the separator
+ */
+token_separator sep_whitespace(void);
+
+/**
+ * @brief Separator for tokenizers that splits at given character, like splitc()
+ * @param c (character to split at)
+ * @return the separator
+ */
+token_separator sep_char(char c);
+
+/**
+ * @brief Separator for tokenizers that splits at any of given characters, like splitnc()
+ * @param params (characters to split at)
+ * @return the separator
+ */
+token_separator sep_charset(const char* params);
+
+/**
+ * @brief Separator for tokenizers that splits at given string, like splitstr()
+ * @param needle (string to split at, it has to outlive the tokenizer)
+ * @return the separator
+ */
+token_separator sep_string(const char* needle);
+
+/**
+ * @brief Creates a tokenizer reading from given stream. The stream doesn't get closed by tokenizer_close().
+ * <br> stream_tokenizer* tok = tokenizer_open_file(stdin, sep_char('\n'), 0)
+ * @warning <b>THIS DOES NOT GET FREED by free_all_stringutils_structures(), free it with tokenizer_close()</b>
+ * @param file (stream to read from)
+ * @param sep (where to split)
+ * @param buffer_size (size of the read buffer, 0 for the default of 64KB)
+ * @return the tokenizer
+ * @see tokenizer_next()
+ */
+stream_tokenizer* tokenizer_open_file(FILE* file, token_separator sep, size_t buffer_size);
+
+/**
+ * @brief Same as tokenizer_open_file() but reads from a file descriptor (pipes and sockets work too).
+ * @param fd (file descriptor to read from)
+ * @param sep (where to split)
+ * @param buffer_size (size of the read buffer, 0 for the default of 64KB)
+ * @return the tokenizer
+ */
+stream_tokenizer* tokenizer_open_fd(int fd, token_separator sep, size_t buffer_size);
+
+/**
+ * @brief Stores the next token in (*token). The view points into the tokenizer buffer and is only valid until the next call.
+ * <br> Tokens are the same ones the matching split function would return for the whole input.
+ * <br> while (tokenizer_next(tok, &token)) { ... }
+ * @warning A failing read raises ReadError, if the handler returns the input ends there and tok->error is set
+ * @param tok
+ * @param token (gets set by the function)
+ * @return 1 if a token was stored, 0 when there are no more
+ */
+int tokenizer_next(stream_tokenizer* tok, strview* token);
+
+/**
+ * @brief Frees a tokenizer made by tokenizer_open_file() or tokenizer_open_fd()
+ * @param tok
+ */
+void tokenizer_close(stream_tokenizer* tok);
+
+// csv functions
+/**
+ * @brief Creates a reader for delimited records held in memory, the fields it hands out point into input.
+ * <br> csv_reader* csv = csv_open(sv_from("id,name\n1,\"Doe, John\"\n"), ',')
+ * @warning <b>THIS DOES NOT GET FREED by free_all_stringutils_structures(), free it with csv_close()</b>
+ * @warning delim can't be '"', '\n' or '\r', InvalidPattern is raised and NULL returned
+ * @param input (records to read, it must outlive the reader)
+ * @param delim (field delimiter, like the separator of splitc())
+ * @return the reader
+ * @see csv_next()
+ */
+csv_reader* csv_open(strview input, char delim);
+
+/**
+ * @brief Same as csv_open() but reads from given stream. The stream doesn't get closed by csv_close().
+ * <br> Records can be longer than the read buffer, it grows to fit them.
+ * @warning <b>THIS DOES NOT GET FREED by free_all_stringutils_structures(), free it with csv_close()</b>
+ * @param file (stream to read from)
+ * @param delim (field delimiter)
+ * @param buffer_size (initial size of the read buffer, 0 for the default of 64KB)
+ * @return the reader
+ * @see csv_next()
+ */
+csv_reader* csv_open_file(FILE* file, char delim, size_t buffer_size);
+
+/**
+ * @brief Same as csv_open_file() but reads from a file descriptor (pipes and sockets work too).
+ * @param fd (file descriptor to read from, it doesn't get closed by csv_close())
+ * @param delim (field delimiter)
+ * @param buffer_size (initial size of the read buffer, 0 for the default of 64KB)
+ * @return the reader
+ */
+csv_reader* csv_open_fd(int fd, char delim, size_t buffer_size);
+
+/**
+ * @brief Reads the next record. Fields are views of the raw input: quoted fields keep their quotes, see csv_unescape().
+ * <br> Like splitc(), empty fields are kept, so an empty line is a record with one empty field. The "\r" of a "\r\n" is dropped.
+ * <br> A quote anywhere in a field switches quoting on or off, an unterminated quote runs until the end of the input.
+ * <br> while ((n = csv_next(csv, &fields)) > 0) { ... } -> {"id", "name"}, then {"1", "\"Doe, John\""}
+ * @warning When reading from a stream or file descriptor the views are only valid until the next call
+ * @warning A failing read raises ReadError, if the handler returns the input ends there and csv->error is set
+ * @param csv (reader)
+ * @param fields (gets set by the function to the fields of the record, owned by the reader)
+ * @return number of fields in the record, 0 once the input is over
+ */
+size_t csv_next(csv_reader* csv, strview** fields);
+
+/**
+ * @brief Returns the content of a field as csv_next() hands it out: quotes are dropped and "" inside quotes becomes a single quote.
+ * <br> csv_unescape(sv_from("\"say \"\"hi\"\"\"")) -> "say \"hi\""
+ * @param field (field to unescape)
+ * @return unescaped field
+ */
+char* csv_unescape(strview field);
+
+/**
+ * @brief Same as csv_unescape() but writes into a buffer owned by the caller, see sv_into().
+ * @param buf (buffer to write into, can be the field itself since the result is never longer)
+ * @param cap (size of buf)
+ * @param field (field to unescape)
+ * @return length of the unescaped field, if it's >= cap the output was truncated
+ */
+long long csv_unescape_into(char* buf, size_t cap, strview field);
+
+/**
+ * @brief Frees a reader made by csv_open(), csv_open_file() or csv_open_fd()
+ * @param csv
+ */
+void csv_close(csv_reader* csv);
+
+// token histogram functions
+/**
+ * @brief Creates an empty token histogram
+ * <br> token_histogram* h = histogram_create(100000); histogram_count_file(h, stdin, sep_whitespace()); histogram_top(h, top, 10);
+ * @warning <b>THIS DOES NOT GET FREED by free_all_stringutils_structures(), free it with histogram_free()</b>
+ * @param max_tokens (most distinct tokens to keep, 0 for no limit, see token_histogram for what happens once it's reached)
+ * @return the histogram, NULL if it couldn't be allocated
+ */
+token_histogram* histogram_create(size_t max_tokens);
+
+/**
+ * @brief Counts a single token, it gets copied only if it wasn't in the histogram yet
+ * @warning If the copy can't be allocated NullPtrError is raised and the token isn't counted
+ * @param h
+ * @param token
+ */
+void histogram_add(token_histogram* h, strview token);
+
+/**
+ * @brief Counts every token of given text, the tokens are the same ones the matching split function would return, but they're never copied.
+ * <br> histogram_count(h, sv_from("a b a"), sep_whitespace()) -> a: 2, b: 1
+ * @param h
+ * @param text
+ * @param sep (where to split)
+ */
+void histogram_count(token_histogram* h, strview text, token_separator sep);
+
+/**
+ * @brief Same as histogram_count() but reads the text from a stream with a tokenizer, so memory use doesn't depend on its size.
+ * @param h
+ * @param file (stream to read from, it doesn't get closed)
+ * @param sep (where to split)
+ * @see tokenizer_open_file()
+ */
+void histogram_count_file(token_histogram* h, FILE* file, token_separator sep);
+
+/**
+ * @brief Same as histogram_count_file() but reads from a file descriptor
+ * @param h
+ * @param fd (file descriptor to read from)
+ * @param sep (where to split)
+ */
+void histogram_count_fd(token_histogram* h, int fd, token_separator sep);
+
+/**
+ * @brief Gets how many times given token was counted
+ * @param h
+ * @param token
+ * @return the count, 0 if the token isn't in the histogram
+ */
+unsigned long long histogram_get(const token_histogram* h, strview token);
+
+/**
+ * @brief Stores the k most counted tokens in out, most counted first (equal counts are sorted by token).
+ * <br> The views point into the histogram and stay valid until it's freed or the token gets evicted.
+ * <br> For all the counts, go through h->entries.
+ * @param h
+ * @param out (array of at least k entries)
+ * @param k
+ * @return the number of entries stored, less than k if the histogram holds fewer tokens
+ */
+size_t histogram_top(const token_histogram* h, token_count* out, size_t k);
+
+/**
+ * @brief Frees a histogram made by histogram_create() and every token it holds
+ * @param h
+ */
+void histogram_free(token_histogram* h);
+
+// string builder functions
+/**
+ * @brief Initializes a builder with room for at least capacity characters.
+ * <br> strbuilder sb; sb_init(&sb, 0); sb_appends(&sb, "hello"); char* s = sb_finish(&sb);
+ * @param sb
+ * @param capacity (initial capacity, it grows as needed)
+ */
+void sb_init(strbuilder* sb, size_t capacity);
+
+/**
+ * @brief Makes sure that additional more characters can be appended without growing the buffer
+ * @warning If the buffer can't grow NullPtrError is raised and the builder is left as it was, appends that don't fit are then dropped
+ * @param sb
+ * @param additional
+ */
+void sb_reserve(strbuilder* sb, size_t additional);
+
+/**
+ * @brief Appends a single character
+ * @param sb
+ * @param c
+ */
+void sb_appendc(strbuilder* sb, char c);
+
+/**
+ * @brief Appends a string
+ * @param sb
+ * @param string
+ */
+void sb_appends(strbuilder* sb, const char* string);
+
+/**
+ * @brief Appends the first len characters of string
+ * <br> string can point into the builder itself, sb_appendn(sb, sb->buf, sb->len) doubles its content
+ * @param sb
+ * @param string
+ * @param len
+ */
+void sb_appendn(strbuilder* sb, const char* string, size_t len);
+
+/**
+ * @brief Appends a string view
+ * @param sb
+ * @param view
+ */
+void sb_appendsv(strbuilder* sb, strview view);
+
+/**
+ * @brief Appends formatted output, like printf()
+ * <br> sb_appendf(&sb, "%d-%s", 12, "ab") -> appends "12-ab"
+ * @warning The arguments can't point into the builder itself, use sb_appendn() for that
+ * @param sb
+ * @param format
+ */
+void sb_appendf(strbuilder* sb, const char* format, ...);
+
+/**
+ * @brief Gets what was built so far as a view, valid until the next append
+ * @param sb
+ * @return the view
+ */
+strview sb_view(const strbuilder* sb);
+
+/**
+ * @brief Empties the builder, keeping its capacity
+ * @param sb
+ */
+void sb_clear(strbuilder* sb);
+
+/**
+ * @brief Hands the buffer over to the internal structs (or leaves it in its arena) without copying it. The builder is left empty and can be initialized again.
+ * @param sb
+ * @return the built string, NULL if the builder never got a buffer
+ */
+char* sb_finish(strbuilder* sb);
+
+/**
+ * @brief Throws away what was built and frees the buffer (unless it lives in an arena)
+ * @param sb
+ */
+void sb_free(strbuilder* sb);
+
+// mapped file functions
+/**
+ * @brief Maps given file read-only in memory and indexes its lines, nothing gets copied in the internal structs.
+ * <br> mapped_file* mf = map_file("log.txt"); strview line = mf_line(mf, 0);
+ * @warning <b>THIS DOES NOT GET FREED by free_all_stringutils_structures(), free it with unmap_file()</b>
+ * @param path (file to map)
+ * @return the mapped file, NULL if the file couldn't be opened or mapped
+ */
+mapped_file* map_file(const char* path);
+
+/**
+ * @brief Gets the line at given index as a view into the mapping (without the '\n')
+ * @param mf
+ * @param index (must be less than mf->count)
+ * @return the line
+ */
+strview mf_line(const mapped_file* mf, size_t index);
+
+/**
+ * @brief Gets the whole contents of the file as a view
+ * @param mf
+ * @return the view
+ */
+strview mf_view(const mapped_file* mf);
+
+/**
+ * @brief Splits a view at every occurrence of given char, like splitc(), storing up to max fields as views in fields
+ * <br> "a,b,,c" -> {"a", "b", "", "c"}, returns 4
+ * @param view
+ * @param c (character to split at)
+ * @param fields (array of at least max views)
+ * @param max
+ * @return the number of fields in the view, if it's more than max only the first max were stored
+ */
+size_t sv_splitc_into(strview view, char c, strview* fields, size_t max);
+
+/**
+ * @brief Unmaps a file mapped by map_file(), views into it become invalid
+ * @param mf
+ */
+void unmap_file(mapped_file* mf);
+
+// interning functions
+/**
+ * @brief Gets the canonical copy of given string from the intern table of the calling thread, adding it if it isn't there yet.
+ * <br> Equal strings give back the same pointer, so interned strings can be compared with == instead of strcmp().
+ * <br> intern("key") == intern("key") -> 1
+ * @warning Interned strings are owned by the table: free_string() ignores them and they stay valid until clear_interned_stringutils()
+ * (or free_all_stringutils_structures()) gets called on the same thread. Don't write to them.
+ * @param string
+ * @return the interned string
+ */
+char* intern(char* string);
+
+/**
+ * @brief Same as intern() but for a view, nothing gets allocated if an equal string was already interned.
+ * @param view
+ * @return the interned string
+ * @see intern()
+ */
+char* sv_intern(strview view);
+
+/**
+ * @brief Checks if given string came from intern() or sv_intern()
+ * @param string (string allocated by this library, or NULL)
+ * @return 1 if it's interned, 0 otherwise
+ */
+int is_interned(const char* string);
+
+/**
+ * @brief Makes split(), splitc(), splitnc(), splitcs() and splitstr() fill their lists with interned strings instead of fresh copies.
+ * <br> Repeated tokens then share their storage and can be compared by pointer. The lists themselves are allocated as usual.
+ * @param enabled (1 to intern the tokens, 0 to go back to copying them)
+ * @see intern()
+ */
+void intern_on_split_stringutils(int enabled);
+
+/**
+ * @brief Gets how many different strings the intern table of the calling thread holds
+ * @return the number of interned strings
+ */
+size_t interned_count_stringutils();
+
+/**
+ * @brief Empties the intern table of the calling thread, every string it returned becomes invalid.
+ * <br> free_all_stringutils_structures() calls this too.
+ */
+void clear_interned_stringutils();
+
+// rope functions
+/**
+ * @brief Creates a rope holding a copy of given text
+ * <br> rope* r = rope_from(sv_from("hello world")); rope_insert(r, 5, sv_from(",")); -> "hello, world"
+ * @warning <b>THIS DOES NOT GET FREED by free_all_stringutils_structures(), free it with rope_free()</b>
+ * @param text
+ * @return the rope
+ */
+rope* rope_from(strview text);
+
+/**
+ * @brief Gets the length of the text held by a rope
+ * @param r
+ * @return the length
+ */
+size_t rope_length(const rope* r);
+
+/**
+ * @brief Inserts a copy of text at given position, in O(log n)
+ * @param r
+ * @param pos (from 0 to rope_length(r))
+ * @param text
+ */
+void rope_insert(rope* r, size_t pos, strview text);
+
+/**
+ * @brief Appends a copy of text at the end of a rope, like append() and sum() without copying what's already there
+ * @param r
+ * @param text
+ */
+void rope_append(rope* r, strview text);
+
+/**
+ * @brief Removes len bytes starting at pos, in O(log n)
+ * @param r
+ * @param pos
+ * @param len
+ */
+void rope_erase(rope* r, size_t pos, size_t len);
+
+/**
+ * @brief Makes a new rope with the bytes from start to end (excluded) in O(log n), the text is shared with r
+ * @warning <b>THIS DOES NOT GET FREED by free_all_stringutils_structures(), free it with rope_free()</b>
+ * @param r
+ * @param start
+ * @param end
+ * @return the new rope
+ */
+rope* rope_substr(const rope* r, size_t start, size_t end);
+
+/**
+ * @brief Appends the text of other to r in O(log n), the text is shared between them
+ * @param r
+ * @param other (can be r itself)
+ */
+void rope_concat(rope* r, const rope* other);
+
+/**
+ * @brief Gets the first index of needle at or after from, occurrences spanning several pieces are found too
+ * @param r
+ * @param needle
+ * @param from
+ * @return first index of occurrence, else -1
+ */
+long long rope_find(const rope* r, strview needle, size_t from);
+
+/**
+ * @brief Counts the occurrences of needle in a rope, like count()
+ * @param r
+ * @param needle
+ * @return n of times needle is found
+ */
+long long rope_count(const rope* r, strview needle);
+
+/**
+ * @brief Replaces every occurrence of needle with rep, like replace(). Only the pieces around the occurrences are touched.
+ * @param r
+ * @param needle
+ * @param rep
+ * @return the number of occurrences replaced
+ */
+long long rope_replace(rope* r, strview needle, strview rep);
+
+/**
+ * @brief Prepares an iterator over the pieces of a rope, starting at given position
+ * <br> rope_iter it; strview piece; rope_iter_init(&it, r, 0); while (rope_next(&it, &piece)) { ... }
+ * @param it
+ * @param r
+ * @param pos
+ */
+void rope_iter_init(rope_iter* it, const rope* r, size_t pos);
+
+/**
+ * @brief Stores the next piece of text in (*piece), in O(log n). The view is valid until the rope is edited or freed.
+ * @param it
+ * @param piece (gets set by the function)
+ * @return 1 if a piece was stored, 0 at the end of the rope
+ */
+int rope_next(rope_iter* it, strview* piece);
+
+/**
+ * @brief Copies the text of a rope in a single new string
+ * @param r
+ * @return the text
+ */
+char* rope_flatten(const rope* r);
+
+/**
+ * @brief Frees a rope, text shared with other ropes stays alive until they're freed too
+ * @param r
+ */
+void rope_free(rope* r);
+
+// allocation utility functions
+/**
+ * @brief Allocates a generic void** pointer of size*count bytes. Size and count are given by the user.
+ * <br>void** ptr = safe_alloc_generic(10, 2)
+ * @warning <b>THIS DOES NOT GET FREED by free_all_stringutils_structures(), it's up to the caller to free this memory</b>
+ * @param size
+ * @param count
+ * @return an allocated void** pointer of given size and count
+ * @see free_all_stringutils_structures()
+ */
+void** safe_alloc_generic(size_t size, size_t count);
+
+/**
+ * @brief Allocates a generic char* pointer of given size (size DOESN'T NEED to account for string terminator)
+ * <br> This DOES get freed by free_all_stringutils_structures(), so you don't need to manually free this memory if you call it
+ * <br> char* str = alloc_safe_str(strlen("this is a test"))
+ * @see free_all_stringutils_structures()
+ * @param size
+ * @return allocated char* pointer
+ */
+char* alloc_safe_str(size_t size);
+
+/**
+ * @brief Frees a single string allocated by this library right away, in O(1), instead of waiting for free_all_stringutils_structures()
+ * <br> Strings allocated from an arena are left alone, a string held by another thread's internal structs is left alone too.
+ * <br> Strings returned by this library (and detached ones) must be released with this, <b>NOT</b> with free().
+ * @param string (string allocated by this library, or NULL)
+ */
+void free_string(char* string);
+
+/**
+ * @brief Frees a list of strings returned by a split function, together with every string it holds, in O(1) per string.
+ * @param vect (list of strings allocated by this library, or NULL)
+ * @see free_string()
+ */
+void free_vect(char** vect);
+
+/**
+ * @brief Creates a new arena, allocations will be served from chunks of chunk_size bytes.
+ * <br> Requests bigger than chunk_size get a dedicated chunk of their own.
+ * <br> stringutils_arena* arena = create_arena_stringutils(1 << 16)
+ * @param chunk_size (size of each chunk, 0 for the default of 64KB)
+ * @return the new arena
+ * @see use_arena_stringutils()
+ */
+stringutils_arena* create_arena_stringutils(size_t chunk_size);
+
+/**
+ * @brief Makes every function of this library allocate from given arena instead of the internal structs.
+ * <br> Passing NULL goes back to the default behaviour.
+ * <br> stringutils_arena* prev = use_arena_stringutils(arena); ... use_arena_stringutils(prev);
+ * @param arena (arena to allocate from, or NULL)
+ * @return the previously used arena (NULL if none was in use)
+ */
+stringutils_arena* use_arena_stringutils(stringutils_arena* arena);
+
+/**
+ * @brief Releases every allocation made from given arena, keeping a single chunk around for reuse.
+ * <br> Any string or list of strings previously allocated from this arena becomes invalid.
+ * @param arena (arena to reset)
+ */
+void reset_arena_stringutils(stringutils_arena* arena);
+
+/**
+ * @brief Frees given arena and all of its chunks. If the arena is currently in use, the library goes back to the internal structs.
+ * @param arena (arena to destroy)
+ */
+void destroy_arena_stringutils(stringutils_arena* arena);
+
+// library functions
+/**
+ * @brief This functions frees each and every string/every list of strings allocated by any function of this header.
+ * <br> This is to facilitate memory management, since you just need to call this function at the end of whatever you want.
+ * <br> Please do note that if this was compiled with GCC this function will be called automatically at program exit if possible.
+ * <br> So make sure to know what you're doing if you call this manually!
+ * <br> If compiled with STRINGUTILS_PER_THREAD, this only frees what the calling thread allocated.
+ * On POSIX systems it also runs automatically when a thread exits.
+ */
+void free_all_stringutils_structures();
+
+/**
+ * @brief Sets up a pool of threads that count, countc, replace, replacec, toupperstr and tolowerstr (and their view versions) split big buffers between.
+ * <br> Only buffers of at least 2*min_chunk bytes are split, results are the same as when running on a single thread.
+ * <br> Only one thread at a time can use the pool, other threads run their calls on their own in the meantime. Not available on Windows.
+ * <br> parallel_init_stringutils(0, 0) -> a thread per cpu, chunks of at least 1MB
+ * @param threads (threads working on a call, including the calling one: 0 for one per cpu, 1 to stop the pool)
+ * @param min_chunk (smallest chunk worth handing to another thread, 0 for the default of 1MB)
+ */
+void parallel_init_stringutils(int threads, size_t min_chunk);
+
+/**
+ * @brief Removes given string from the internal structs (of the calling thread), the caller becomes its owner.
+ * <br> This is how a string is handed over to another thread: detach it on the thread that made it,
+ * then either adopt it on the receiving thread with adopt_string_stringutils() or release it there with free_string().
+ * <br> No locks are involved since each side only touches its own structs.
+ * @param string (string allocated by this library on the calling thread)
+ * @return the same string, or NULL if it isn't held by the calling thread
+ * @see adopt_string_stringutils()
+ */
+char* detach_string_stringutils(char* string);
+
+/**
+ * @brief Adds a detached string to the internal structs of the calling thread, it'll get freed by free_all_stringutils_structures() from now on.
+ * @param string (string previously returned by detach_string_stringutils())
+ * @see detach_string_stringutils()
+ */
+void adopt_string_stringutils(char* string);
+
+/**
+ * @brief Same as detach_string_stringutils() but for a list of strings and every string it holds.
+ * @param vect (list of strings allocated by this library on the calling thread)
+ * @param size (length of the list)
+ * @return the same list, or NULL if it isn't held by the calling thread
+ * @see adopt_vect_stringutils()
+ */
+char** detach_vect_stringutils(char** vect, int size);
+
+/**
+ * @brief Same as adopt_string_stringutils() but for a list of strings and every string it holds.
+ * @param vect (list previously returned by detach_vect_stringutils())
+ * @param size (length of the list)
+ * @see detach_vect_stringutils()
+ */
+void adopt_vect_stringutils(char** vect, int size);
+
+/**
+ * @brief Exposes internal list of all currently allocated strings. Use with caution, as this has no guarantees.
+ * <br> To free a string from this use free_string(), which also updates the list.
+ * @return pointer to internal struct of strings
+ */
+alloced_strings* expose_internal_strings();
+
+/**
+ * @brief Exposes internal list of all currently allocated lists of strings. Use with caution, as this has no guarantees.
+ * <br> To free a list from this use free_vect(), which also frees its strings and updates both lists.
+ * @return pointer to internal struct of list of strings
+ */
+alloced_vects* expose_internal_vectors();
+
+/**
+ * @brief Exposes the live per function statistics as a list (see set_trace_lvl_stringutils() with Profile)
+ * <br> The list only contains functions that were called at least once while profiling, it's NULL if the library wasn't compiled with STRINGUTILS_PROFILE
+ * @return the first entry of the list
+ */
+stringutils_profile_entry* expose_internal_profile();
+
+/**
+ * @brief Copies the per function statistics in entries, linking the copies together through next.
+ * @param entries (array of at least max entries)
+ * @param max
+ * @return the number of functions with statistics, if it's more than max only the first max were copied
+ */
+int snapshot_profile_stringutils(stringutils_profile_entry* entries, int max);
+
+/**
+ * @brief Zeroes all per function statistics
+ */
+void reset_profile_stringutils();
+
+/**
+ * @brief Writes the per function statistics of every called function to given file as JSON
+ * @param file
+ */
+void dump_profile_stringutils(FILE* file);
+
+/**
+ * @brief Makes the library write the per function statistics to given path when the program exits, see dump_profile_stringutils()
+ * @param path (file to write, NULL to cancel)
+ */
+void set_profile_dump_stringutils(const char* path);
 
 /**
  * @brief This is a function that (if needed) <b>has</b> to be called at the start of the program execution (or before any function of this library gets called).
  * The purpose of this function is to override the default starting sizes of the structs that hold the refs.
+ * <br> With STRINGUTILS_PER_THREAD, the sizes apply to every thread that hasn't allocated anything yet.
  * <br> user_init(200, 10) -> will set size of alloced_strings to 200 and of alloced_vects to 10
  * @see alloced_strings
  * @see alloced_vects
@@ -517,7 +2636,7 @@ void override_signal_exception_stringutils(void (*func)(int));
 /**
  * @brief This function must be called in order to modify the trace level of the library.
  * <br> By default it's set to NoTrace
- * @param trace_lvl (trace level to set, valid values are only NoTrace or Warn)
+ * @param trace_lvl (trace level to set, valid values are NoTrace, Warn or Profile)
  * @see StringUtilsTraceLvl
  */
 void set_trace_lvl_stringutils(StringUtilsTraceLvl trace_lvl);